@@ -37,6 +37,14 @@
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable the FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear both FIFOs. */
+
+/* Number of bytes the transmit FIFO holds.  Once THR Empty is
+   set, this many bytes may be written back to back. */
+#define FIFO_SIZE 16
+
 /* Line Control Register bits. */
 #define LCR_N81 0x03            /* No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80           /* Divisor Latch Access Bit (DLAB). */
@@ -46,7 +54,7 @@
 
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
-#define LSR_THRE 0x20           /* THR Empty. */
+#define LSR_THRE 0x20           /* THR Empty (transmit FIFO empty). */
 
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
@@ -55,7 +63,8 @@ static enum { UNINIT, POLL, QUEUE } mode;
 static struct intq txq;
 
 static void set_serial (int bps);
-static void putc_poll (uint8_t);
+static void wait_fifo_empty (void);
+static void fill_fifo (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -68,7 +77,7 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR); /* Enable FIFO. */
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
   intq_init (&txq);
@@ -97,32 +106,65 @@ serial_init_queue (void)
 /* Sends BYTE to the serial port. */
 void
 serial_putc (uint8_t byte) 
+{
+  serial_putbuf (&byte, 1);
+}
+
+/* Sends the N bytes in BUFFER to the serial port. */
+void
+serial_putbuf (const uint8_t *buffer, size_t n) 
 {
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit the bytes. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (n > 0)
+        {
+          size_t chunk = n < FIFO_SIZE ? n : FIFO_SIZE;
+
+          n -= chunk;
+          wait_fifo_empty ();
+          while (chunk-- > 0)
+            outb (THR_REG, *buffer++);
+        }
     }
   else 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      /* Otherwise, queue the bytes and update the interrupt
+         enable register. */
+      for (; n > 0; n--)
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          if (intq_full (&txq)) 
+            {
+              if (old_level == INTR_OFF)
+                {
+                  /* Interrupts are off and the transmit queue is
+                     full.  If we wanted to wait for the queue to
+                     empty, we'd have to reenable interrupts.
+                     That's impolite, so we'll send a FIFO's worth
+                     of characters via polling instead. */
+                  wait_fifo_empty ();
+                  fill_fifo (); 
+                }
+              else
+                {
+                  /* intq_putc() will wait for the transmit
+                     interrupt to make room, so make sure it is
+                     enabled. */
+                  fill_fifo ();
+                  write_ier ();
+                }
+            }
+          intq_putc (&txq, *buffer++); 
         }
 
-      intq_putc (&txq, byte); 
+      /* Start transmitting now if the port is idle, instead of
+         waiting for an interrupt. */
+      fill_fifo ();
       write_ier ();
     }
   
@@ -136,7 +178,10 @@ serial_flush (void)
 {
   enum intr_level old_level = intr_disable ();
   while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+    {
+      wait_fifo_empty ();
+      fill_fifo ();
+    }
   intr_set_level (old_level);
 }
 
@@ -193,16 +238,30 @@ write_ier (void)
   outb (IER_REG, ier);
 }
 
-/* Polls the serial port until it's ready,
-   and then transmits BYTE. */
+/* Polls the serial port until its transmit FIFO is empty. */
 static void
-putc_poll (uint8_t byte) 
+wait_fifo_empty (void) 
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
   while ((inb (LSR_REG) & LSR_THRE) == 0)
     continue;
-  outb (THR_REG, byte);
+}
+
+/* If the transmit FIFO is empty, refills it from the transmit
+   queue, with up to FIFO_SIZE bytes. */
+static void
+fill_fifo (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
+    {
+      int i;
+
+      for (i = 0; i < FIFO_SIZE && !intq_empty (&txq); i++)
+        outb (THR_REG, intq_getc (&txq));
+    }
 }
 
 /* Serial interrupt handler. */
@@ -218,10 +277,8 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* Refill the transmit FIFO if it has drained. */
+  fill_fifo ();
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
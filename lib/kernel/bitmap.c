@@ -3,6 +3,7 @@
 #include <limits.h>
 #include <round.h>
 #include <stdio.h>
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 #ifdef FILESYS
 #include "filesys/file.h"
@@ -23,11 +24,22 @@ typedef unsigned long elem_type;
 
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   A bitmap created with BITMAP_SUMMARY also has a second, much
+   smaller array of bits, in which bit K is set if and only if
+   element K of BITS has at least one bit set to false.  Searches
+   for false bits use it to skip full elements ELEM_BITS at a
+   time, so finding a single false bit takes time proportional to
+   the number of summary elements rather than the number of
+   elements.  Each change to BITS also updates the summary, with
+   interrupts disabled so that the two stay consistent. */
 struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
+    size_t next;        /* Where the next next-fit scan starts. */
     elem_type *bits;    /* Elements that represent bits. */
+    elem_type *summary; /* Elements of BITS with false bits, or null. */
   };
 
 /* Returns the index of the element that contains the bit
@@ -46,6 +58,14 @@ bit_mask (size_t bit_idx)
   return (elem_type) 1 << (bit_idx % ELEM_BITS);
 }
 
+/* Returns an elem_type with the bits corresponding to BIT_IDX
+   and every later bit in the same element turned on. */
+static inline elem_type
+bits_from (size_t bit_idx) 
+{
+  return (elem_type) -1 << (bit_idx % ELEM_BITS);
+}
+
 /* Returns the number of elements required for BIT_CNT bits. */
 static inline size_t
 elem_cnt (size_t bit_cnt)
@@ -77,44 +97,72 @@ last_mask (const struct bitmap *b)
    when it is no longer needed. */
 struct bitmap *
 bitmap_create (size_t bit_cnt) 
+{
+  return bitmap_create_flags (bit_cnt, 0);
+}
+
+/* Creates and returns a bitmap with room for BIT_CNT bits, as
+   bitmap_create() does.  If BITMAP_SUMMARY is set in FLAGS, the
+   bitmap keeps a summary that speeds up searches for false
+   bits. */
+struct bitmap *
+bitmap_create_flags (size_t bit_cnt, enum bitmap_flags flags) 
 {
   struct bitmap *b = malloc (sizeof *b);
   if (b != NULL)
     {
       b->bit_cnt = bit_cnt;
+      b->next = 0;
       b->bits = malloc (byte_cnt (bit_cnt));
-      if (b->bits != NULL || bit_cnt == 0)
+      b->summary = NULL;
+      if (flags & BITMAP_SUMMARY)
+        b->summary = malloc (byte_cnt (elem_cnt (bit_cnt)));
+      if ((b->bits != NULL || bit_cnt == 0)
+          && (b->summary != NULL || !(flags & BITMAP_SUMMARY)
+              || bit_cnt == 0))
         {
           bitmap_set_all (b, false);
           return b;
         }
+      free (b->bits);
+      free (b->summary);
       free (b);
     }
   return NULL;
 }
 
 /* Creates and returns a bitmap with BIT_CNT bits in the
-   BLOCK_SIZE bytes of storage preallocated at BLOCK.
-   BLOCK_SIZE must be at least bitmap_needed_bytes(BIT_CNT). */
+   BLOCK_SIZE bytes of storage preallocated at BLOCK, with FLAGS
+   as for bitmap_create_flags().
+   BLOCK_SIZE must be at least bitmap_buf_size(BIT_CNT, FLAGS). */
 struct bitmap *
-bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
+bitmap_create_in_buf (size_t bit_cnt, enum bitmap_flags flags,
+                      void *block, size_t block_size UNUSED)
 {
   struct bitmap *b = block;
   
-  ASSERT (block_size >= bitmap_buf_size (bit_cnt));
+  ASSERT (block_size >= bitmap_buf_size (bit_cnt, flags));
 
   b->bit_cnt = bit_cnt;
+  b->next = 0;
   b->bits = (elem_type *) (b + 1);
+  b->summary = NULL;
+  if (flags & BITMAP_SUMMARY)
+    b->summary = b->bits + elem_cnt (bit_cnt);
   bitmap_set_all (b, false);
   return b;
 }
 
 /* Returns the number of bytes required to accomodate a bitmap
-   with BIT_CNT bits (for use with bitmap_create_in_buf()). */
+   with BIT_CNT bits and the given FLAGS (for use with
+   bitmap_create_in_buf()). */
 size_t
-bitmap_buf_size (size_t bit_cnt) 
+bitmap_buf_size (size_t bit_cnt, enum bitmap_flags flags) 
 {
-  return sizeof (struct bitmap) + byte_cnt (bit_cnt);
+  size_t size = sizeof (struct bitmap) + byte_cnt (bit_cnt);
+  if (flags & BITMAP_SUMMARY)
+    size += byte_cnt (elem_cnt (bit_cnt));
+  return size;
 }
 
 /* Destroys bitmap B, freeing its storage.
@@ -125,10 +173,43 @@ bitmap_destroy (struct bitmap *b)
   if (b != NULL) 
     {
       free (b->bits);
+      free (b->summary);
       free (b);
     }
 }
-
+
+/* Brings the summary bit for element IDX of B up to date.  B
+   must have a summary. */
+static void
+update_summary (struct bitmap *b, size_t idx) 
+{
+  elem_type full = (idx == elem_cnt (b->bit_cnt) - 1
+                    ? last_mask (b) : (elem_type) -1);
+
+  if ((b->bits[idx] & full) != full)
+    b->summary[elem_idx (idx)] |= bit_mask (idx);
+  else
+    b->summary[elem_idx (idx)] &= ~bit_mask (idx);
+}
+
+/* Returns the index of the first element of B at or after IDX
+   that has a false bit according to B's summary, or a value of
+   at least elem_cnt(B->bit_cnt) if there is none. */
+static size_t
+next_summary (const struct bitmap *b, size_t idx) 
+{
+  size_t sidx = elem_idx (idx);
+  size_t scnt = elem_cnt (elem_cnt (b->bit_cnt));
+  elem_type e;
+
+  if (sidx >= scnt)
+    return SIZE_MAX;
+  for (e = b->summary[sidx] & bits_from (idx); e == 0; e = b->summary[sidx])
+    if (++sidx >= scnt)
+      return SIZE_MAX;
+  return sidx * ELEM_BITS + __builtin_ctzl (e);
+}
+
 /* Bitmap size. */
 
 /* Returns the number of bits in B. */
@@ -162,7 +243,15 @@ bitmap_mark (struct bitmap *b, size_t bit_idx)
   /* This is equivalent to `b->bits[idx] |= mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the OR instruction in [IA32-v2b]. */
-  asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  if (b->summary == NULL)
+    asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  else 
+    {
+      enum intr_level old_level = intr_disable ();
+      b->bits[idx] |= mask;
+      update_summary (b, idx);
+      intr_set_level (old_level);
+    }
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -175,7 +264,15 @@ bitmap_reset (struct bitmap *b, size_t bit_idx)
   /* This is equivalent to `b->bits[idx] &= ~mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the AND instruction in [IA32-v2a]. */
-  asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  if (b->summary == NULL)
+    asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  else 
+    {
+      enum intr_level old_level = intr_disable ();
+      b->bits[idx] &= ~mask;
+      update_summary (b, idx);
+      intr_set_level (old_level);
+    }
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -190,7 +287,15 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
   /* This is equivalent to `b->bits[idx] ^= mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
-  asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  if (b->summary == NULL)
+    asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  else 
+    {
+      enum intr_level old_level = intr_disable ();
+      b->bits[idx] ^= mask;
+      update_summary (b, idx);
+      intr_set_level (old_level);
+    }
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -213,18 +318,41 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.  Whole
+   elements are set at once, and each element is updated
+   atomically. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end = start + cnt;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  while (start < end) 
+    {
+      size_t idx = elem_idx (start);
+      elem_type mask = bits_from (start);
+
+      if (end - start < ELEM_BITS - start % ELEM_BITS)
+        mask &= ~bits_from (end);
+      if (b->summary != NULL) 
+        {
+          enum intr_level old_level = intr_disable ();
+          if (value)
+            b->bits[idx] |= mask;
+          else
+            b->bits[idx] &= ~mask;
+          update_summary (b, idx);
+          intr_set_level (old_level);
+        }
+      else if (value)
+        asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+      start = (idx + 1) * ELEM_BITS;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -245,21 +373,43 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
   return value_cnt;
 }
 
+/* Returns the index of the first bit in B at or after START, and
+   before END, that is set to VALUE, or END if there is none.
+   Skips elements that hold no such bit a whole element at a
+   time, or, when looking for a false bit in a bitmap with a
+   summary, as many elements as the summary shows to be full. */
+static size_t
+find_bit (const struct bitmap *b, size_t start, size_t end, bool value) 
+{
+  elem_type flip = value ? 0 : (elem_type) -1;
+  size_t idx = elem_idx (start);
+  elem_type e;
+
+  if (start >= end)
+    return end;
+  for (e = (b->bits[idx] ^ flip) & bits_from (start); e == 0;
+       e = b->bits[idx] ^ flip) 
+    {
+      idx = (!value && b->summary != NULL
+             ? next_summary (b, idx + 1) : idx + 1);
+      if (idx >= elem_cnt (end))
+        return end;
+    }
+
+  start = idx * ELEM_BITS + __builtin_ctzl (e);
+  return start < end ? start : end;
+}
+
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -288,6 +438,35 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /* Finding set or unset bits. */
 
+/* Finds and returns the starting index of the first group of CNT
+   consecutive bits in B at or after START, and wholly before
+   END, that are all set to VALUE.
+   If there is no such group, returns BITMAP_ERROR. */
+static size_t
+scan_range (const struct bitmap *b, size_t start, size_t end, size_t cnt,
+            bool value) 
+{
+  if (cnt > end || start > end - cnt)
+    return BITMAP_ERROR;
+  if (cnt == 0)
+    return start;
+
+  /* Alternately find the start of a run of VALUE bits and the
+     end of that run, until one is long enough. */
+  for (;;) 
+    {
+      size_t run_end;
+
+      start = find_bit (b, start, end, value);
+      if (start > end - cnt)
+        return BITMAP_ERROR;
+      run_end = find_bit (b, start, start + cnt, !value);
+      if (run_end == start + cnt)
+        return start;
+      start = run_end;
+    }
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
@@ -298,15 +477,7 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
-    {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
-    }
-  return BITMAP_ERROR;
+  return scan_range (b, start, b->bit_cnt, cnt, value);
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -324,7 +495,34 @@ bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
     bitmap_set_multiple (b, idx, cnt, !value);
   return idx;
 }
-
+
+/* Like bitmap_scan_and_flip(), but starts looking where the
+   previous call to this function left off, wrapping around to
+   the start of B if necessary, so that repeated allocations do
+   not scan the bits that earlier ones used up over and over. */
+size_t
+bitmap_scan_and_flip_next (struct bitmap *b, size_t cnt, bool value) 
+{
+  size_t idx, end;
+
+  ASSERT (b != NULL);
+
+  if (b->next > b->bit_cnt)
+    b->next = 0;
+  idx = scan_range (b, b->next, b->bit_cnt, cnt, value);
+  if (idx == BITMAP_ERROR) 
+    {
+      end = b->next + cnt - 1 < b->bit_cnt ? b->next + cnt - 1 : b->bit_cnt;
+      idx = scan_range (b, 0, end, cnt, value);
+    }
+  if (idx != BITMAP_ERROR) 
+    {
+      bitmap_set_multiple (b, idx, cnt, !value);
+      b->next = idx + cnt;
+    }
+  return idx;
+}
+
 /* File input and output. */
 
 #ifdef FILESYS
@@ -344,8 +542,13 @@ bitmap_read (struct bitmap *b, struct file *file)
   if (b->bit_cnt > 0) 
     {
       off_t size = byte_cnt (b->bit_cnt);
+      size_t i;
+
       success = file_read_at (file, b->bits, size, 0) == size;
       b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+      if (b->summary != NULL)
+        for (i = 0; i < elem_cnt (b->bit_cnt); i++)
+          update_summary (b, i);
     }
   return success;
 }
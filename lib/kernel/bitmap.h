@@ -7,10 +7,18 @@
 
 /* Bitmap abstract data type. */
 
+/* How to create a bitmap. */
+enum bitmap_flags
+  {
+    BITMAP_SUMMARY = 001        /* Index elements with false bits. */
+  };
+
 /* Creation and destruction. */
 struct bitmap *bitmap_create (size_t bit_cnt);
-struct bitmap *bitmap_create_in_buf (size_t bit_cnt, void *, size_t byte_cnt);
-size_t bitmap_buf_size (size_t bit_cnt);
+struct bitmap *bitmap_create_flags (size_t bit_cnt, enum bitmap_flags);
+struct bitmap *bitmap_create_in_buf (size_t bit_cnt, enum bitmap_flags,
+                                     void *, size_t byte_cnt);
+size_t bitmap_buf_size (size_t bit_cnt, enum bitmap_flags);
 void bitmap_destroy (struct bitmap *);
 
 /* Bitmap size. */
@@ -36,6 +44,7 @@ bool bitmap_all (const struct bitmap *, size_t start, size_t cnt);
 #define BITMAP_ERROR SIZE_MAX
 size_t bitmap_scan (const struct bitmap *, size_t start, size_t cnt, bool);
 size_t bitmap_scan_and_flip (struct bitmap *, size_t start, size_t cnt, bool);
+size_t bitmap_scan_and_flip_next (struct bitmap *, size_t cnt, bool);
 
 /* File input and output. */
 #ifdef FILESYS
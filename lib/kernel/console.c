@@ -1,6 +1,7 @@
 #include <console.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/serial.h"
 #include "devices/vga.h"
 #include "threads/init.h"
@@ -8,7 +9,7 @@
 #include "threads/synch.h"
 
 static void vprintf_helper (char, void *);
-static void putchar_have_lock (uint8_t c);
+static void putbuf_have_lock (const char *, size_t);
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -59,6 +60,21 @@ static int console_lock_depth;
 /* Number of characters written to console. */
 static int64_t write_cnt;
 
+/* vprintf() formats its output into a buffer of this many bytes
+   on the stack, then writes the buffer to the console all at
+   once, instead of a character at a time.  Longer output is
+   written whenever the buffer fills. */
+#define PRINTF_BUF_SIZE 128
+
+/* Output buffer for vprintf(). */
+struct printf_buf
+  {
+    char buf[PRINTF_BUF_SIZE];  /* Formatted output not yet written. */
+    size_t used;                /* Number of bytes in BUF. */
+    int char_cnt;               /* Total characters formatted. */
+    bool locked;                /* Console lock acquired? */
+  };
+
 /* Enable console locking. */
 void
 console_init (void) 
@@ -69,11 +85,13 @@ console_init (void)
 
 /* Notifies the console that a kernel panic is underway,
    which warns it to avoid trying to take the console lock from
-   now on. */
+   now on.  Also pushes out any output still queued for the
+   serial port, so that it appears before the panic message. */
 void
 console_panic (void) 
 {
   use_console_lock = false;
+  serial_flush ();
 }
 
 /* Prints console statistics. */
@@ -121,17 +139,24 @@ console_locked_by_current_thread (void)
 
 /* The standard vprintf() function,
    which is like printf() but uses a va_list.
-   Writes its output to both vga display and serial port. */
+   Writes its output to both vga display and serial port,
+   PRINTF_BUF_SIZE bytes at a time. */
 int
 vprintf (const char *format, va_list args) 
 {
-  int char_cnt = 0;
+  struct printf_buf b;
 
-  acquire_console ();
-  __vprintf (format, args, vprintf_helper, &char_cnt);
+  b.used = 0;
+  b.char_cnt = 0;
+  b.locked = false;
+  __vprintf (format, args, vprintf_helper, &b);
+
+  if (!b.locked)
+    acquire_console ();
+  putbuf_have_lock (b.buf, b.used);
   release_console ();
 
-  return char_cnt;
+  return b.char_cnt;
 }
 
 /* Writes string S to the console, followed by a new-line
@@ -140,9 +165,8 @@ int
 puts (const char *s) 
 {
   acquire_console ();
-  while (*s != '\0')
-    putchar_have_lock (*s++);
-  putchar_have_lock ('\n');
+  putbuf_have_lock (s, strlen (s));
+  putbuf_have_lock ("\n", 1);
   release_console ();
 
   return 0;
@@ -153,8 +177,7 @@ void
 putbuf (const char *buffer, size_t n) 
 {
   acquire_console ();
-  while (n-- > 0)
-    putchar_have_lock (*buffer++);
+  putbuf_have_lock (buffer, n);
   release_console ();
 }
 
@@ -162,30 +185,47 @@ putbuf (const char *buffer, size_t n)
 int
 putchar (int c) 
 {
+  char ch = c;
+
   acquire_console ();
-  putchar_have_lock (c);
+  putbuf_have_lock (&ch, 1);
   release_console ();
   
   return c;
 }
 
-/* Helper function for vprintf(). */
+/* Helper function for vprintf().  Adds C to the buffer in
+   B_, writing the buffer out first if it is full.  The first
+   time that happens, takes the console lock and keeps it until
+   vprintf() is done, so that the pieces of the output are not
+   mixed with other threads' output. */
 static void
-vprintf_helper (char c, void *char_cnt_) 
+vprintf_helper (char c, void *b_) 
 {
-  int *char_cnt = char_cnt_;
-  (*char_cnt)++;
-  putchar_have_lock (c);
+  struct printf_buf *b = b_;
+
+  if (b->used >= sizeof b->buf)
+    {
+      if (!b->locked)
+        {
+          acquire_console ();
+          b->locked = true;
+        }
+      putbuf_have_lock (b->buf, b->used);
+      b->used = 0;
+    }
+  b->buf[b->used++] = c;
+  b->char_cnt++;
 }
 
-/* Writes C to the vga display and serial port.
-   The caller has already acquired the console lock if
-   appropriate. */
+/* Writes the N characters in BUFFER to the vga display and
+   serial port.  The caller has already acquired the console lock
+   if appropriate. */
 static void
-putchar_have_lock (uint8_t c) 
+putbuf_have_lock (const char *buffer, size_t n) 
 {
   ASSERT (console_locked_by_current_thread ());
-  write_cnt++;
-  serial_putc (c);
-  vga_putc (c);
+  write_cnt += n;
+  serial_putbuf ((const uint8_t *) buffer, n);
+  vga_putbuf (buffer, n);
 }
@@ -6,6 +6,8 @@
    See hash.h for basic information. */
 
 #include "hash.h"
+#include <stdint.h>
+#include <string.h>
 #include "../debug.h"
 #include "threads/malloc.h"
 
@@ -261,46 +263,115 @@ hash_empty (struct hash *h)
 #define FNV_32_PRIME 16777619u
 #define FNV_32_BASIS 2166136261u
 
+/* MurmurHash3 (x86, 32-bit) constants. */
+#define MURMUR_C1 0xcc9e2d51u
+#define MURMUR_C2 0x1b873593u
+#define MURMUR_SEED 0u
+
+/* An unaligned word of the buffer being hashed.  The i386
+   handles unaligned loads itself, so this is cheaper than
+   assembling each word from bytes. */
+typedef uint32_t __attribute__ ((may_alias, aligned (1))) word_t;
+
+/* Returns X rotated left by N bits. */
+static inline uint32_t
+rotl (uint32_t x, int n)
+{
+  return (x << n) | (x >> (32 - n));
+}
+
+/* Scrambles word K for mixing into the hash. */
+static inline uint32_t
+mix_word (uint32_t k)
+{
+  k *= MURMUR_C1;
+  k = rotl (k, 15);
+  k *= MURMUR_C2;
+  return k;
+}
+
+/* Mixes the bits of H so that each input bit affects every
+   output bit, in particular the low-order bits that pick a
+   bucket. */
+static inline uint32_t
+finalize (uint32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
 /* Returns a hash of the SIZE bytes in BUF. */
 unsigned
 hash_bytes (const void *buf_, size_t size)
 {
-  /* Fowler-Noll-Vo 32-bit hash, for bytes. */
+  /* MurmurHash3, 32-bit: consumes BUF four bytes at a time. */
   const unsigned char *buf = buf_;
-  unsigned hash;
+  uint32_t hash = MURMUR_SEED;
+  uint32_t k = 0;
+  size_t left;
 
   ASSERT (buf != NULL);
 
-  hash = FNV_32_BASIS;
-  while (size-- > 0)
-    hash = (hash * FNV_32_PRIME) ^ *buf++;
+  for (left = size; left >= 4; left -= 4, buf += 4)
+    {
+      hash ^= mix_word (*(const word_t *) buf);
+      hash = rotl (hash, 13);
+      hash = hash * 5 + 0xe6546b64u;
+    }
 
-  return hash;
+  switch (left)
+    {
+    case 3:
+      k ^= (uint32_t) buf[2] << 16;
+      /* Fall through. */
+    case 2:
+      k ^= (uint32_t) buf[1] << 8;
+      /* Fall through. */
+    case 1:
+      k ^= buf[0];
+      hash ^= mix_word (k);
+    }
+
+  return finalize (hash ^ size);
 } 
 
 /* Returns a hash of string S. */
 unsigned
-hash_string (const char *s_) 
+hash_string (const char *s) 
 {
-  const unsigned char *s = (const unsigned char *) s_;
-  unsigned hash;
-
   ASSERT (s != NULL);
 
-  hash = FNV_32_BASIS;
-  while (*s != '\0')
-    hash = (hash * FNV_32_PRIME) ^ *s++;
-
-  return hash;
+  /* strlen() scans a word at a time, so two passes beat one
+     byte-wise pass. */
+  return hash_bytes (s, strlen (s));
 }
 
 /* Returns a hash of integer I. */
 unsigned
 hash_int (int i) 
 {
-  return hash_bytes (&i, sizeof i);
+  /* FNV-1 over I's four bytes, from least significant.  Tables
+     keyed by integers are mostly keyed by runs of consecutive
+     integers, such as page or sector numbers, or by integers a
+     power of two apart, such as addresses.  FNV-1 spreads both
+     evenly over the buckets, where a strong mixing function such
+     as the MurmurHash3 finalizer only spreads them as well as
+     random values, leaving about 1 in 7 buckets empty and others
+     with chains of 6 or more at the usual load. */
+  uint32_t u = i;
+  unsigned hash = FNV_32_BASIS;
+
+  hash = (hash * FNV_32_PRIME) ^ (u & 0xff);
+  hash = (hash * FNV_32_PRIME) ^ ((u >> 8) & 0xff);
+  hash = (hash * FNV_32_PRIME) ^ ((u >> 16) & 0xff);
+  hash = (hash * FNV_32_PRIME) ^ (u >> 24);
+  return hash;
 }
-
+
 /* Returns the bucket in H that E belongs in. */
 static struct list *
 find_bucket (struct hash *h, struct hash_elem *e) 
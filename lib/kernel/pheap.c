@@ -0,0 +1,225 @@
+/* Pairing heap.
+
+   See pheap.h for basic information.
+
+   A pairing heap is a tree in which each element is no less than
+   its parent, so the root is the minimum.  Each element keeps
+   its children in a doubly linked list, through `next' and
+   `prev', with the first child's `prev' pointing back to the
+   parent.  Two heaps merge by making the root that is not
+   smaller the first child of the other.  Removing the root
+   leaves its children as a list of heaps, which are merged in
+   pairs from left to right and then the pairs are merged from
+   right to left; this "two-pass" merge is what gives the
+   amortized O(lg n) bound. */
+
+#include "pheap.h"
+#include "../debug.h"
+
+static struct pheap_elem *meld (struct pheap *, struct pheap_elem *,
+                                struct pheap_elem *);
+static struct pheap_elem *merge_pairs (struct pheap *,
+                                       struct pheap_elem *first);
+static void detach (struct pheap_elem *);
+
+/* Initializes H as an empty heap that orders its elements with
+   LESS, given auxiliary data AUX. */
+void
+pheap_init (struct pheap *h, pheap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->elem_cnt = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+pheap_insert (struct pheap *h, struct pheap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  h->root = h->root != NULL ? meld (h, h->root, e) : e;
+  h->elem_cnt++;
+}
+
+/* Moves all the elements of OTHER into H, leaving OTHER empty.
+   Both heaps must use the same ordering. */
+void
+pheap_merge (struct pheap *h, struct pheap *other)
+{
+  ASSERT (h != NULL);
+  ASSERT (other != NULL);
+  ASSERT (h != other);
+
+  if (other->root != NULL)
+    {
+      h->root = h->root != NULL ? meld (h, h->root, other->root)
+                                : other->root;
+      h->elem_cnt += other->elem_cnt;
+      other->root = NULL;
+      other->elem_cnt = 0;
+    }
+}
+
+/* Removes the minimum element from H and returns it.  H must not
+   be empty. */
+struct pheap_elem *
+pheap_pop_min (struct pheap *h)
+{
+  struct pheap_elem *min = h->root;
+
+  ASSERT (min != NULL);
+
+  h->root = merge_pairs (h, min->child);
+  h->elem_cnt--;
+  min->child = NULL;
+  return min;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+pheap_remove (struct pheap *h, struct pheap_elem *e)
+{
+  struct pheap_elem *children;
+
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  if (e == h->root)
+    {
+      pheap_pop_min (h);
+      return;
+    }
+
+  /* Cut E out of its parent's list of children, then merge its
+     own children back into the heap. */
+  detach (e);
+  children = merge_pairs (h, e->child);
+  if (children != NULL)
+    h->root = meld (h, h->root, children);
+  h->elem_cnt--;
+  e->child = NULL;
+}
+
+/* Restores H's order after the value of E, which must be in H,
+   has decreased. */
+void
+pheap_decrease (struct pheap *h, struct pheap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  /* E is still no greater than its children, so it can be cut
+     out along with them and merged with the rest of the heap as
+     a heap of its own. */
+  if (e != h->root)
+    {
+      detach (e);
+      h->root = meld (h, h->root, e);
+    }
+}
+
+/* Returns the minimum element in H, or a null pointer if H is
+   empty. */
+struct pheap_elem *
+pheap_min (struct pheap *h)
+{
+  ASSERT (h != NULL);
+  return h->root;
+}
+
+/* Returns the number of elements in H. */
+size_t
+pheap_size (struct pheap *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+pheap_empty (struct pheap *h)
+{
+  return h->root == NULL;
+}
+
+/* Merges the heaps rooted at A and B, which have no siblings or
+   parents, using H's ordering, and returns the new root. */
+static struct pheap_elem *
+meld (struct pheap *h, struct pheap_elem *a, struct pheap_elem *b)
+{
+  if (h->less (b, a, h->aux))
+    {
+      struct pheap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the first child of A. */
+  b->next = a->child;
+  if (b->next != NULL)
+    b->next->prev = b;
+  b->prev = a;
+  a->child = b;
+  return a;
+}
+
+/* Merges the list of sibling heaps that starts at FIRST into a
+   single heap and returns its root, or a null pointer if the
+   list is empty. */
+static struct pheap_elem *
+merge_pairs (struct pheap *h, struct pheap_elem *first)
+{
+  struct pheap_elem *pairs = NULL;
+  struct pheap_elem *root = NULL;
+
+  /* Merge the heaps in pairs from left to right, pushing each
+     result onto PAIRS, which is linked through `next'. */
+  while (first != NULL)
+    {
+      struct pheap_elem *a = first;
+      struct pheap_elem *b = a->next;
+
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        {
+          first = b->next;
+          b->next = b->prev = NULL;
+          a = meld (h, a, b);
+        }
+      else
+        first = NULL;
+      a->next = pairs;
+      pairs = a;
+    }
+
+  /* Merge the pairs, from right to left. */
+  while (pairs != NULL)
+    {
+      struct pheap_elem *next = pairs->next;
+
+      pairs->next = NULL;
+      root = root != NULL ? meld (h, root, pairs) : pairs;
+      pairs = next;
+    }
+  return root;
+}
+
+/* Removes E, which must not be a root, from its parent's list of
+   children.  E keeps its own children. */
+static void
+detach (struct pheap_elem *e)
+{
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  e->next = e->prev = NULL;
+}
@@ -0,0 +1,83 @@
+#ifndef __LIB_KERNEL_PHEAP_H
+#define __LIB_KERNEL_PHEAP_H
+
+/* Pairing heap.
+
+   A pairing heap is a priority queue: it finds its minimum
+   element in O(1) time, where list_min() scans the whole list.
+   Inserting an element or merging two heaps takes O(1) time,
+   removing the minimum or any other element takes amortized
+   O(lg n) time, and moving an element whose value has decreased
+   takes O(1) time plus, in amortized terms, O(lg n) later.
+
+   Like lists and hash tables, heaps do not use dynamic
+   allocation.  Instead, each structure that can potentially be
+   in a heap must embed a struct pheap_elem member, and the
+   pheap_entry macro converts from a struct pheap_elem back to
+   the structure that contains it.  Refer to lib/kernel/list.h
+   for a detailed explanation of this technique.
+
+   Elements are ordered by a `less' function supplied when the
+   heap is initialized.  To keep a maximum instead of a minimum,
+   supply a function that returns true when A is greater than B.
+   Among elements that compare equal, pheap_min() returns an
+   arbitrary one.
+
+   While an element is in a heap, the values that `less' looks at
+   must not change, except that they may change so as to make
+   the element smaller if pheap_decrease() is called right after.
+   To make an element bigger, remove it, change it, and insert it
+   again. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct pheap_elem
+  {
+    struct pheap_elem *child;   /* First child, or null. */
+    struct pheap_elem *next;    /* Next sibling, or null. */
+    struct pheap_elem *prev;    /* Previous sibling, or parent if first
+                                   child, or null if root. */
+  };
+
+/* Converts pointer to heap element PHEAP_ELEM into a pointer to
+   the structure that PHEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define pheap_entry(PHEAP_ELEM, STRUCT, MEMBER)                 \
+        ((STRUCT *) ((uint8_t *) &(PHEAP_ELEM)->child           \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool pheap_less_func (const struct pheap_elem *a,
+                              const struct pheap_elem *b,
+                              void *aux);
+
+/* Pairing heap. */
+struct pheap
+  {
+    struct pheap_elem *root;    /* Minimum element, or null if empty. */
+    size_t elem_cnt;            /* Number of elements in heap. */
+    pheap_less_func *less;      /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void pheap_init (struct pheap *, pheap_less_func *, void *aux);
+
+/* Insertion and removal. */
+void pheap_insert (struct pheap *, struct pheap_elem *);
+void pheap_merge (struct pheap *, struct pheap *);
+struct pheap_elem *pheap_pop_min (struct pheap *);
+void pheap_remove (struct pheap *, struct pheap_elem *);
+void pheap_decrease (struct pheap *, struct pheap_elem *);
+
+/* Information. */
+struct pheap_elem *pheap_min (struct pheap *);
+size_t pheap_size (struct pheap *);
+bool pheap_empty (struct pheap *);
+
+#endif /* lib/kernel/pheap.h */
@@ -0,0 +1,435 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.
+
+   The tree keeps the usual red-black invariants: the root is
+   black, a red element has no red children, and every path from
+   an element down to a null child passes through the same number
+   of black elements.  Together these keep the tree's height
+   below 2 lg (n + 1).  Null children count as black. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+                          struct rb_elem *parent);
+
+/* Initializes T as an empty tree that orders its elements with
+   LESS, given auxiliary data AUX. */
+void
+rb_init (struct rb_tree *t, rb_less_func *less, void *aux)
+{
+  ASSERT (t != NULL);
+  ASSERT (less != NULL);
+
+  t->root = t->first = NULL;
+  t->elem_cnt = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/* Inserts E into T, after any elements that compare equal to
+   it. */
+void
+rb_insert (struct rb_tree *t, struct rb_elem *e)
+{
+  struct rb_elem **link = &t->root;
+  struct rb_elem *parent = NULL;
+  bool leftmost = true;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (t->less (e, parent, t->aux))
+        link = &parent->left;
+      else
+        {
+          link = &parent->right;
+          leftmost = false;
+        }
+    }
+
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+  if (leftmost)
+    t->first = e;
+  t->elem_cnt++;
+
+  insert_fixup (t, e);
+}
+
+/* Removes E, which must be in T, from T. */
+void
+rb_remove (struct rb_tree *t, struct rb_elem *e)
+{
+  struct rb_elem *child, *parent;
+  bool removed_red;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+  ASSERT (t->elem_cnt > 0);
+
+  if (t->first == e)
+    t->first = rb_next (e);
+  t->elem_cnt--;
+
+  if (e->left == NULL || e->right == NULL)
+    {
+      /* E has at most one child, which takes its place. */
+      child = e->left != NULL ? e->left : e->right;
+      parent = e->parent;
+      removed_red = e->red;
+      if (parent == NULL)
+        t->root = child;
+      else if (parent->left == e)
+        parent->left = child;
+      else
+        parent->right = child;
+      if (child != NULL)
+        child->parent = parent;
+    }
+  else
+    {
+      /* E has two children.  Its successor S, the leftmost
+         element of its right subtree, has no left child.  Unlink
+         S from its position, then put S in E's place, with E's
+         color, so that the imbalance is where S was. */
+      struct rb_elem *s = e->right;
+
+      while (s->left != NULL)
+        s = s->left;
+      child = s->right;
+      removed_red = s->red;
+      if (s->parent == e)
+        parent = s;
+      else
+        {
+          parent = s->parent;
+          parent->left = child;
+          if (child != NULL)
+            child->parent = parent;
+          s->right = e->right;
+          s->right->parent = s;
+        }
+
+      if (e->parent == NULL)
+        t->root = s;
+      else if (e->parent->left == e)
+        e->parent->left = s;
+      else
+        e->parent->right = s;
+      s->parent = e->parent;
+      s->left = e->left;
+      s->left->parent = s;
+      s->red = e->red;
+    }
+
+  /* Removing a black element shortens the paths through it. */
+  if (!removed_red)
+    remove_fixup (t, child, parent);
+}
+
+/* Removes the first element from T and returns it.  T must not
+   be empty. */
+struct rb_elem *
+rb_pop_first (struct rb_tree *t)
+{
+  struct rb_elem *e = rb_first (t);
+
+  ASSERT (e != NULL);
+  rb_remove (t, e);
+  return e;
+}
+
+/* Returns the first element in T that compares equal to E, or a
+   null pointer if there is none. */
+struct rb_elem *
+rb_find (struct rb_tree *t, const struct rb_elem *e)
+{
+  struct rb_elem *node = t->root;
+  struct rb_elem *found = NULL;
+
+  while (node != NULL)
+    if (t->less (e, node, t->aux))
+      node = node->left;
+    else if (t->less (node, e, t->aux))
+      node = node->right;
+    else
+      {
+        /* Keep looking for an earlier equal element. */
+        found = node;
+        node = node->left;
+      }
+  return found;
+}
+
+/* Returns the first element in T, or a null pointer if T is
+   empty. */
+struct rb_elem *
+rb_first (struct rb_tree *t)
+{
+  ASSERT (t != NULL);
+  return t->first;
+}
+
+/* Returns the last element in T, or a null pointer if T is
+   empty. */
+struct rb_elem *
+rb_last (struct rb_tree *t)
+{
+  struct rb_elem *e = t->root;
+
+  if (e != NULL)
+    while (e->right != NULL)
+      e = e->right;
+  return e;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the last element. */
+struct rb_elem *
+rb_next (struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->right != NULL)
+    {
+      e = e->right;
+      while (e->left != NULL)
+        e = e->left;
+      return e;
+    }
+  while (e->parent != NULL && e->parent->right == e)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the element that precedes E in its tree, or a null
+   pointer if E is the first element. */
+struct rb_elem *
+rb_prev (struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->left != NULL)
+    {
+      e = e->left;
+      while (e->right != NULL)
+        e = e->right;
+      return e;
+    }
+  while (e->parent != NULL && e->parent->left == e)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (struct rb_tree *t)
+{
+  return t->elem_cnt;
+}
+
+/* Returns true if T contains no elements, false otherwise. */
+bool
+rb_empty (struct rb_tree *t)
+{
+  return t->elem_cnt == 0;
+}
+
+/* Returns true if E is a red element, false if it is black or
+   null. */
+static inline bool
+is_red (const struct rb_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Puts NEW in the place of OLD as a child of OLD's parent in T. */
+static void
+replace_child (struct rb_tree *t, struct rb_elem *old, struct rb_elem *new)
+{
+  struct rb_elem *parent = old->parent;
+
+  if (parent == NULL)
+    t->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+  new->parent = parent;
+}
+
+/* Rotates the subtree rooted at E in T to the left, so that E's
+   right child takes E's place and E becomes its left child. */
+static void
+rotate_left (struct rb_tree *t, struct rb_elem *e)
+{
+  struct rb_elem *r = e->right;
+
+  e->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = e;
+  replace_child (t, e, r);
+  r->left = e;
+  e->parent = r;
+}
+
+/* Rotates the subtree rooted at E in T to the right, so that E's
+   left child takes E's place and E becomes its right child. */
+static void
+rotate_right (struct rb_tree *t, struct rb_elem *e)
+{
+  struct rb_elem *l = e->left;
+
+  e->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = e;
+  replace_child (t, e, l);
+  l->right = e;
+  e->parent = l;
+}
+
+/* Restores the red-black invariants in T after red element E
+   has been inserted, which may have given a red parent a red
+   child. */
+static void
+insert_fixup (struct rb_tree *t, struct rb_elem *e)
+{
+  struct rb_elem *parent;
+
+  while (is_red (parent = e->parent))
+    {
+      /* A red parent is not the root, so it has a parent. */
+      struct rb_elem *grandparent = parent->parent;
+
+      if (parent == grandparent->left)
+        {
+          struct rb_elem *uncle = grandparent->right;
+          if (is_red (uncle))
+            {
+              /* Push the grandparent's blackness down a level
+                 and continue from the grandparent. */
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+              continue;
+            }
+          if (e == parent->right)
+            {
+              rotate_left (t, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          grandparent->red = true;
+          rotate_right (t, grandparent);
+        }
+      else
+        {
+          struct rb_elem *uncle = grandparent->left;
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+              continue;
+            }
+          if (e == parent->left)
+            {
+              rotate_right (t, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          grandparent->red = true;
+          rotate_left (t, grandparent);
+        }
+    }
+  t->root->red = false;
+}
+
+/* Restores the red-black invariants in T after a black element
+   has been removed from the place where E, which may be null, now
+   is, as a child of PARENT.  Paths through E are one black
+   element short. */
+static void
+remove_fixup (struct rb_tree *t, struct rb_elem *e, struct rb_elem *parent)
+{
+  while (e != t->root && !is_red (e))
+    {
+      /* Paths through E's sibling have at least one more black
+         element than paths through E, so the sibling exists. */
+      if (e == parent->left)
+        {
+          struct rb_elem *sibling = parent->right;
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_left (t, parent);
+              sibling = parent->right;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              /* Shorten the sibling's paths too and move the
+                 problem up a level. */
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+              continue;
+            }
+          if (!is_red (sibling->right))
+            {
+              sibling->left->red = false;
+              sibling->red = true;
+              rotate_right (t, sibling);
+              sibling = parent->right;
+            }
+          sibling->red = parent->red;
+          parent->red = false;
+          sibling->right->red = false;
+          rotate_left (t, parent);
+        }
+      else
+        {
+          struct rb_elem *sibling = parent->left;
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_right (t, parent);
+              sibling = parent->left;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+              continue;
+            }
+          if (!is_red (sibling->left))
+            {
+              sibling->right->red = false;
+              sibling->red = true;
+              rotate_left (t, sibling);
+              sibling = parent->left;
+            }
+          sibling->red = parent->red;
+          parent->red = false;
+          sibling->left->red = false;
+          rotate_right (t, parent);
+        }
+      e = t->root;
+    }
+  if (e != NULL)
+    e->red = false;
+}
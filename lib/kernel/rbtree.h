@@ -0,0 +1,96 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A red-black tree keeps its elements in order, like a list
+   maintained with list_insert_ordered(), but inserts and removes
+   elements in O(lg n) time instead of O(n), and still finds the
+   minimum in O(1) time.
+
+   Like lists and hash tables, trees do not use dynamic
+   allocation.  Instead, each structure that can potentially be
+   in a tree must embed a struct rb_elem member, and the rb_entry
+   macro converts from a struct rb_elem back to the structure
+   that contains it.  Refer to lib/kernel/list.h for a detailed
+   explanation of this technique.
+
+   Elements are ordered by a `less' function supplied when the
+   tree is initialized.  A tree may hold several elements that
+   compare equal: a new element goes after those already there,
+   just as with list_insert_ordered(), so a tree of threads
+   ordered by priority runs equal-priority threads round-robin.
+
+   Iterate over a tree in order like this:
+
+      struct rb_elem *e;
+
+      for (e = rb_first (&foo_tree); e != NULL; e = rb_next (e))
+        {
+          struct foo *f = rb_entry (e, struct foo, elem);
+          ...do something with f...
+        }
+
+   The tree must not be modified during such a loop, except that
+   the element just returned may be removed if rb_next() was
+   called on it first. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rb_elem
+  {
+    struct rb_elem *parent;     /* Parent, or null for the root. */
+    struct rb_elem *left;       /* Left child, or null. */
+    struct rb_elem *right;      /* Right child, or null. */
+    bool red;                   /* Red or black? */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to the
+   structure that RB_ELEM is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                       \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent             \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rb_tree
+  {
+    struct rb_elem *root;       /* Root, or null if empty. */
+    struct rb_elem *first;      /* Leftmost element, or null if empty. */
+    size_t elem_cnt;            /* Number of elements in tree. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rb_init (struct rb_tree *, rb_less_func *, void *aux);
+
+/* Insertion and removal. */
+void rb_insert (struct rb_tree *, struct rb_elem *);
+void rb_remove (struct rb_tree *, struct rb_elem *);
+struct rb_elem *rb_pop_first (struct rb_tree *);
+
+/* Search. */
+struct rb_elem *rb_find (struct rb_tree *, const struct rb_elem *);
+
+/* Traversal. */
+struct rb_elem *rb_first (struct rb_tree *);
+struct rb_elem *rb_last (struct rb_tree *);
+struct rb_elem *rb_next (struct rb_elem *);
+struct rb_elem *rb_prev (struct rb_elem *);
+
+/* Information. */
+size_t rb_size (struct rb_tree *);
+bool rb_empty (struct rb_tree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,443 @@
+/* Open-addressing hash table.
+
+   See rhash.h for basic information. */
+
+#include "rhash.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Number of slots in a new table. */
+#define MIN_SLOTS 16
+
+/* Number of migration steps that each insertion or deletion
+   takes while the table is growing.  A step moves one element
+   out of the old array or moves past one empty slot.  Growth
+   starts when the old array is 3/4 full, so emptying it takes
+   at most its size plus its element count, 7/4 of its size, in
+   steps.  The next growth starts 3/4 of the old array's size
+   insertions later, so 3 steps per insertion would do; with 4,
+   the old array is empty after 7/16 of its size in insertions,
+   and insert_new() rarely has to finish migrating itself. */
+#define MIGRATE_STEP 4
+
+static bool array_init (struct rhash_array *, size_t slot_cnt);
+static struct rhash_slot *array_find (struct rhash *, struct rhash_array *,
+                                      unsigned hash, struct hash_elem *);
+static void array_insert (struct rhash_array *, unsigned hash,
+                          struct hash_elem *);
+static void array_remove (struct rhash_array *, struct rhash_slot *);
+static struct rhash_slot *find_slot (struct rhash *, unsigned hash,
+                                     struct hash_elem *,
+                                     struct rhash_array **);
+static bool insert_new (struct rhash *, unsigned hash, struct hash_elem *);
+static void migrate (struct rhash *, size_t step_cnt);
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using LESS, given auxiliary data AUX.
+   Returns true if successful, false if memory allocation
+   fails. */
+bool
+rhash_init (struct rhash *h,
+            hash_hash_func *hash, hash_less_func *less, void *aux) 
+{
+  h->old.slot_cnt = h->old.elem_cnt = 0;
+  h->old.slots = NULL;
+  h->migrate_idx = 0;
+  h->hash = hash;
+  h->less = less;
+  h->aux = aux;
+  return array_init (&h->cur, MIN_SLOTS);
+}
+
+/* Removes all the elements from H.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the hash.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the hash element.  However, modifying hash
+   table H while rhash_clear() is running, using any of the
+   functions rhash_clear(), rhash_destroy(), rhash_insert(),
+   rhash_replace(), or rhash_delete(), yields undefined behavior,
+   whether done in DESTRUCTOR or elsewhere. */
+void
+rhash_clear (struct rhash *h, hash_action_func *destructor) 
+{
+  size_t i;
+
+  if (destructor != NULL)
+    rhash_apply (h, destructor);
+
+  free (h->old.slots);
+  h->old.slot_cnt = h->old.elem_cnt = 0;
+  h->old.slots = NULL;
+  h->migrate_idx = 0;
+
+  for (i = 0; i < h->cur.slot_cnt; i++)
+    h->cur.slots[i].elem = NULL;
+  h->cur.elem_cnt = 0;
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the hash, as in rhash_clear(). */
+void
+rhash_destroy (struct rhash *h, hash_action_func *destructor) 
+{
+  if (destructor != NULL)
+    rhash_apply (h, destructor);
+  free (h->old.slots);
+  free (h->cur.slots);
+}
+
+/* Inserts NEW into hash table H and returns a null pointer, if
+   no equal element is already in the table.
+   If an equal element is already in the table, returns it
+   without inserting NEW.  If memory allocation fails, returns
+   NEW without inserting it. */
+struct hash_elem *
+rhash_insert (struct rhash *h, struct hash_elem *new) 
+{
+  unsigned hash = h->hash (new, h->aux);
+  struct rhash_array *a;
+  struct rhash_slot *s;
+
+  migrate (h, MIGRATE_STEP);
+  s = find_slot (h, hash, new, &a);
+  if (s != NULL)
+    return s->elem;
+  return insert_new (h, hash, new) ? NULL : new;
+}
+
+/* Inserts NEW into hash table H, replacing any equal element
+   already in the table, which is returned.  If memory
+   allocation fails, returns NEW without inserting it. */
+struct hash_elem *
+rhash_replace (struct rhash *h, struct hash_elem *new) 
+{
+  unsigned hash = h->hash (new, h->aux);
+  struct rhash_array *a;
+  struct rhash_slot *s;
+
+  migrate (h, MIGRATE_STEP);
+  s = find_slot (h, hash, new, &a);
+  if (s != NULL) 
+    {
+      struct hash_elem *old = s->elem;
+      s->elem = new;
+      return old;
+    }
+  return insert_new (h, hash, new) ? NULL : new;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table. */
+struct hash_elem *
+rhash_find (struct rhash *h, struct hash_elem *e) 
+{
+  struct rhash_array *a;
+  struct rhash_slot *s = find_slot (h, h->hash (e, h->aux), e, &a);
+  return s != NULL ? s->elem : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table.
+
+   If the elements of the hash table are dynamically allocated,
+   or own resources that are, then it is the caller's
+   responsibility to deallocate them. */
+struct hash_elem *
+rhash_delete (struct rhash *h, struct hash_elem *e) 
+{
+  unsigned hash = h->hash (e, h->aux);
+  struct rhash_array *a;
+  struct rhash_slot *s;
+  struct hash_elem *found;
+
+  migrate (h, MIGRATE_STEP);
+  s = find_slot (h, hash, e, &a);
+  if (s == NULL)
+    return NULL;
+  found = s->elem;
+  array_remove (a, s);
+  return found;
+}
+
+/* Calls ACTION for each element in hash table H in arbitrary
+   order.
+   Modifying hash table H while rhash_apply() is running, using
+   any of the functions rhash_clear(), rhash_destroy(),
+   rhash_insert(), rhash_replace(), or rhash_delete(), yields
+   undefined behavior, whether done from ACTION or elsewhere. */
+void
+rhash_apply (struct rhash *h, hash_action_func *action) 
+{
+  struct rhash_iterator i;
+
+  ASSERT (action != NULL);
+
+  rhash_first (&i, h);
+  while (rhash_next (&i))
+    action (rhash_cur (&i), h->aux);
+}
+
+/* Initializes I for iterating hash table H, with the same idiom
+   as hash_first().
+
+   Modifying hash table H during iteration, using any of the
+   functions rhash_clear(), rhash_destroy(), rhash_insert(),
+   rhash_replace(), or rhash_delete(), invalidates all
+   iterators. */
+void
+rhash_first (struct rhash_iterator *i, struct rhash *h) 
+{
+  ASSERT (i != NULL);
+  ASSERT (h != NULL);
+
+  i->hash = h;
+  i->array = &h->cur;
+  i->idx = 0;
+  i->elem = NULL;
+}
+
+/* Advances I to the next element in the hash table and returns
+   it.  Returns a null pointer if no elements are left.  Elements
+   are returned in arbitrary order. */
+struct hash_elem *
+rhash_next (struct rhash_iterator *i) 
+{
+  ASSERT (i != NULL);
+
+  for (;;) 
+    {
+      while (i->idx < i->array->slot_cnt) 
+        {
+          struct hash_elem *e = i->array->slots[i->idx++].elem;
+          if (e != NULL)
+            return i->elem = e;
+        }
+      if (i->array != &i->hash->cur)
+        return i->elem = NULL;
+      i->array = &i->hash->old;
+      i->idx = 0;
+    }
+}
+
+/* Returns the current element in the hash table iteration, or a
+   null pointer at the end of the table.  Undefined behavior
+   after calling rhash_first() but before rhash_next(). */
+struct hash_elem *
+rhash_cur (struct rhash_iterator *i) 
+{
+  return i->elem;
+}
+
+/* Returns the number of elements in H. */
+size_t
+rhash_size (struct rhash *h) 
+{
+  return h->cur.elem_cnt + h->old.elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+rhash_empty (struct rhash *h) 
+{
+  return rhash_size (h) == 0;
+}
+
+/* Initializes A as an array of SLOT_CNT empty slots.  Returns
+   true if successful, false if memory allocation fails. */
+static bool
+array_init (struct rhash_array *a, size_t slot_cnt) 
+{
+  size_t i;
+
+  a->slots = malloc (sizeof *a->slots * slot_cnt);
+  if (a->slots == NULL)
+    return false;
+  a->slot_cnt = slot_cnt;
+  a->elem_cnt = 0;
+  for (i = 0; i < slot_cnt; i++)
+    a->slots[i].elem = NULL;
+  return true;
+}
+
+/* Returns how far slot IDX in A, which holds an element with
+   hash value HASH, is from that element's home slot. */
+static inline size_t
+distance (const struct rhash_array *a, size_t idx, unsigned hash) 
+{
+  return (idx - hash) & (a->slot_cnt - 1);
+}
+
+/* Searches A, which belongs to H, for an element equal to E,
+   whose hash value is HASH.  Returns its slot if found or a null
+   pointer otherwise. */
+static struct rhash_slot *
+array_find (struct rhash *h, struct rhash_array *a, unsigned hash,
+            struct hash_elem *e) 
+{
+  size_t mask = a->slot_cnt - 1;
+  size_t idx, dist;
+
+  if (a->elem_cnt == 0)
+    return NULL;
+
+  /* Robin Hood ordering means that an element farther from its
+     home than E would be here cannot be followed by E. */
+  for (idx = hash & mask, dist = 0; ; idx = (idx + 1) & mask, dist++) 
+    {
+      struct rhash_slot *s = &a->slots[idx];
+
+      if (s->elem == NULL || distance (a, idx, s->hash) < dist)
+        return NULL;
+      if (s->hash == hash
+          && !h->less (s->elem, e, h->aux) && !h->less (e, s->elem, h->aux))
+        return s;
+    }
+}
+
+/* Inserts E, whose hash value is HASH, into A, which must have
+   an empty slot and no element equal to E. */
+static void
+array_insert (struct rhash_array *a, unsigned hash, struct hash_elem *e) 
+{
+  size_t mask = a->slot_cnt - 1;
+  struct rhash_slot new;
+  size_t idx, dist;
+
+  ASSERT (a->elem_cnt < a->slot_cnt);
+
+  new.hash = hash;
+  new.elem = e;
+  for (idx = hash & mask, dist = 0; ; idx = (idx + 1) & mask, dist++) 
+    {
+      struct rhash_slot *s = &a->slots[idx];
+      size_t s_dist;
+
+      if (s->elem == NULL) 
+        {
+          *s = new;
+          a->elem_cnt++;
+          return;
+        }
+
+      /* Take the slot of an element closer to home, and carry
+         on inserting that element instead. */
+      s_dist = distance (a, idx, s->hash);
+      if (s_dist < dist) 
+        {
+          struct rhash_slot tmp = *s;
+          *s = new;
+          new = tmp;
+          dist = s_dist;
+        }
+    }
+}
+
+/* Removes the element in slot S of A, shifting the elements
+   after it back by one slot until one is already in its home
+   slot, so that no probe sequence is broken. */
+static void
+array_remove (struct rhash_array *a, struct rhash_slot *s) 
+{
+  size_t mask = a->slot_cnt - 1;
+  size_t idx = s - a->slots;
+
+  for (;;) 
+    {
+      size_t next = (idx + 1) & mask;
+      struct rhash_slot *n = &a->slots[next];
+
+      if (n->elem == NULL || distance (a, next, n->hash) == 0)
+        break;
+      a->slots[idx] = *n;
+      idx = next;
+    }
+  a->slots[idx].elem = NULL;
+  a->elem_cnt--;
+}
+
+/* Searches H for an element equal to E, whose hash value is
+   HASH.  If found, returns its slot and stores the array that
+   holds it in *A.  Otherwise returns a null pointer. */
+static struct rhash_slot *
+find_slot (struct rhash *h, unsigned hash, struct hash_elem *e,
+           struct rhash_array **a) 
+{
+  struct rhash_slot *s;
+
+  *a = &h->cur;
+  s = array_find (h, *a, hash, e);
+  if (s == NULL) 
+    {
+      *a = &h->old;
+      s = array_find (h, *a, hash, e);
+    }
+  return s;
+}
+
+/* Inserts E, whose hash value is HASH and which is not yet in H,
+   into H, first starting to grow H if it is 3/4 full.  Returns
+   true if successful, false if H is full and cannot grow. */
+static bool
+insert_new (struct rhash *h, unsigned hash, struct hash_elem *e) 
+{
+  if ((rhash_size (h) + 1) * 4 > h->cur.slot_cnt * 3) 
+    {
+      struct rhash_array new;
+
+      /* Finish any growth still in progress. */
+      migrate (h, SIZE_MAX);
+
+      if (array_init (&new, h->cur.slot_cnt * 2)) 
+        {
+          free (h->old.slots);
+          h->old = h->cur;
+          h->cur = new;
+          h->migrate_idx = 0;
+        }
+      else if (h->cur.elem_cnt + 1 >= h->cur.slot_cnt)
+        return false;
+    }
+
+  array_insert (&h->cur, hash, e);
+  return true;
+}
+
+/* Moves elements from H's old array into its current array,
+   examining up to STEP_CNT slots, and frees the old array once
+   it is empty. */
+static void
+migrate (struct rhash *h, size_t step_cnt) 
+{
+  struct rhash_array *old = &h->old;
+
+  for (; step_cnt > 0 && old->elem_cnt > 0; step_cnt--) 
+    {
+      struct rhash_slot *s;
+
+      ASSERT (h->migrate_idx < old->slot_cnt);
+      s = &old->slots[h->migrate_idx];
+
+      /* Removing an element may shift the next one back into
+         this slot, so only move on once it is empty. */
+      if (s->elem != NULL) 
+        {
+          struct rhash_slot moved = *s;
+          array_remove (old, s);
+          array_insert (&h->cur, moved.hash, moved.elem);
+        }
+      else
+        h->migrate_idx++;
+    }
+
+  if (old->slots != NULL && old->elem_cnt == 0) 
+    {
+      free (old->slots);
+      old->slots = NULL;
+      old->slot_cnt = 0;
+      h->migrate_idx = 0;
+    }
+}
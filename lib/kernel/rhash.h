@@ -0,0 +1,90 @@
+#ifndef __LIB_KERNEL_RHASH_H
+#define __LIB_KERNEL_RHASH_H
+
+/* Open-addressing hash table.
+
+   This is an alternative to the hash table in hash.h with the
+   same interface: elements embed a struct hash_elem, and the
+   table is driven by the same hash_hash_func and hash_less_func
+   callbacks, so a client can switch from one to the other by
+   renaming its calls from hash_*() to rhash_*().
+
+   Instead of chaining elements in linked lists, the table keeps
+   an array of slots, each holding a pointer to an element and a
+   copy of its hash value.  Collisions are resolved by linear
+   probing with Robin Hood ordering: an element being inserted
+   takes the slot of any element that is closer to its own home
+   slot, so that probe sequences stay short and a lookup can stop
+   as soon as it passes the point where its key would have been.
+   The cached hash values mean that the `less' function is only
+   called for elements whose hashes match, and that elements can
+   be moved without calling `hash' again.
+
+   When the table grows, elements are not all moved at once.
+   Instead, the old array is kept alongside the new one, and each
+   later insertion or deletion moves a few more elements across,
+   so no single operation pays for a whole rehash.  Lookups
+   search both arrays while this is going on. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "hash.h"
+
+/* A slot in an rhash array. */
+struct rhash_slot
+  {
+    unsigned hash;              /* Hash value of ELEM. */
+    struct hash_elem *elem;     /* Element, or null if empty. */
+  };
+
+/* An array of slots. */
+struct rhash_array
+  {
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    size_t elem_cnt;            /* Number of slots in use. */
+    struct rhash_slot *slots;   /* Array of `slot_cnt' slots. */
+  };
+
+/* Open-addressing hash table. */
+struct rhash
+  {
+    struct rhash_array cur;     /* Array for new elements. */
+    struct rhash_array old;     /* Array being emptied into CUR. */
+    size_t migrate_idx;         /* Next slot in OLD to empty. */
+    hash_hash_func *hash;       /* Hash function. */
+    hash_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `hash' and `less'. */
+  };
+
+/* An rhash iterator. */
+struct rhash_iterator
+  {
+    struct rhash *hash;         /* The hash table. */
+    struct rhash_array *array;  /* Current array. */
+    size_t idx;                 /* Current slot in ARRAY. */
+    struct hash_elem *elem;     /* Current element. */
+  };
+
+/* Basic life cycle. */
+bool rhash_init (struct rhash *, hash_hash_func *, hash_less_func *,
+                 void *aux);
+void rhash_clear (struct rhash *, hash_action_func *);
+void rhash_destroy (struct rhash *, hash_action_func *);
+
+/* Search, insertion, deletion. */
+struct hash_elem *rhash_insert (struct rhash *, struct hash_elem *);
+struct hash_elem *rhash_replace (struct rhash *, struct hash_elem *);
+struct hash_elem *rhash_find (struct rhash *, struct hash_elem *);
+struct hash_elem *rhash_delete (struct rhash *, struct hash_elem *);
+
+/* Iteration. */
+void rhash_apply (struct rhash *, hash_action_func *);
+void rhash_first (struct rhash_iterator *, struct rhash *);
+struct hash_elem *rhash_next (struct rhash_iterator *);
+struct hash_elem *rhash_cur (struct rhash_iterator *);
+
+/* Information. */
+size_t rhash_size (struct rhash *);
+bool rhash_empty (struct rhash *);
+
+#endif /* lib/kernel/rhash.h */
@@ -3,6 +3,8 @@
 #include <random.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 /* Converts a string representation of a signed decimal integer
    in S into an `int', which is returned. */
@@ -52,7 +54,7 @@ compare_thunk (const void *a, const void *b, void *aux)
    using COMPARE.  When COMPARE is passed a pair of elements A
    and B, respectively, it must return a strcmp()-type result,
    i.e. less than zero if A < B, zero if A == B, greater than
-   zero if A > B.  Runs in O(n lg n) time and O(1) space in
+   zero if A > B.  Runs in O(n lg n) time and O(lg n) space in
    CNT. */
 void
 qsort (void *array, size_t cnt, size_t size,
@@ -61,43 +63,82 @@ qsort (void *array, size_t cnt, size_t size,
   sort (array, cnt, size, compare_thunk, &compare);
 }
 
-/* Swaps elements with 1-based indexes A_IDX and B_IDX in ARRAY
-   with elements of SIZE bytes each. */
+/* Partitions with this many elements or fewer are sorted by
+   insertion sort, which beats dividing them further. */
+#define INSERTION_CNT 12
+
+/* Swaps two elements of SIZE bytes. */
+typedef void swap_func (void *, void *, size_t size);
+
+/* Swaps the SIZE bytes at A and B one byte at a time. */
 static void
-do_swap (unsigned char *array, size_t a_idx, size_t b_idx, size_t size)
+swap_bytes (void *a_, void *b_, size_t size)
 {
-  unsigned char *a = array + (a_idx - 1) * size;
-  unsigned char *b = array + (b_idx - 1) * size;
-  size_t i;
+  unsigned char *a = a_;
+  unsigned char *b = b_;
 
-  for (i = 0; i < size; i++)
+  while (size-- > 0)
     {
-      unsigned char t = a[i];
-      a[i] = b[i];
-      b[i] = t;
+      unsigned char t = *a;
+      *a++ = *b;
+      *b++ = t;
     }
 }
 
-/* Compares elements with 1-based indexes A_IDX and B_IDX in
-   ARRAY with elements of SIZE bytes each, using COMPARE to
-   compare elements, passing AUX as auxiliary data, and returns a
-   strcmp()-type result. */
-static int
-do_compare (unsigned char *array, size_t a_idx, size_t b_idx, size_t size,
-            int (*compare) (const void *, const void *, void *aux),
-            void *aux) 
+/* Swaps the SIZE bytes at A and B one word at a time.  A, B, and
+   SIZE must be multiples of the word size. */
+static void
+swap_words (void *a_, void *b_, size_t size)
 {
-  return compare (array + (a_idx - 1) * size, array + (b_idx - 1) * size, aux);
+  uint32_t *a = a_;
+  uint32_t *b = b_;
+
+  for (size /= sizeof *a; size-- > 0; )
+    {
+      uint32_t t = *a;
+      *a++ = *b;
+      *b++ = t;
+    }
+}
+
+/* Returns the fastest swap function for elements of SIZE bytes
+   in ARRAY. */
+static swap_func *
+choose_swap (const void *array, size_t size) 
+{
+  if (((uintptr_t) array | size) % sizeof (uint32_t) == 0)
+    return swap_words;
+  else
+    return swap_bytes;
+}
+
+/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
+   by insertion sort, using COMPARE and AUX to compare elements
+   and SWAP to swap them.  Equal elements keep their order. */
+static void
+insertion_sort (unsigned char *array, size_t cnt, size_t size,
+                int (*compare) (const void *, const void *, void *aux),
+                void *aux, swap_func *swap)
+{
+  unsigned char *end = array + cnt * size;
+  unsigned char *i, *j;
+
+  for (i = array + size; i < end; i += size)
+    for (j = i; j > array && compare (j - size, j, aux) > 0; j -= size)
+      swap (j - size, j, size);
 }
 
 /* "Float down" the element with 1-based index I in ARRAY of CNT
    elements of SIZE bytes each, using COMPARE to compare
-   elements, passing AUX as auxiliary data. */
+   elements, passing AUX as auxiliary data, and SWAP to swap
+   them. */
 static void
 heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
          int (*compare) (const void *, const void *, void *aux),
-         void *aux) 
+         void *aux, swap_func *swap) 
 {
+  unsigned char *base = array - size;   /* 1-based view of ARRAY. */
+
   for (;;) 
     {
       /* Set `max' to the index of the largest element among I
@@ -105,10 +146,11 @@ heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
       size_t left = 2 * i;
       size_t right = 2 * i + 1;
       size_t max = i;
-      if (left <= cnt && do_compare (array, left, max, size, compare, aux) > 0)
+      if (left <= cnt
+          && compare (base + left * size, base + max * size, aux) > 0)
         max = left;
       if (right <= cnt
-          && do_compare (array, right, max, size, compare, aux) > 0) 
+          && compare (base + right * size, base + max * size, aux) > 0) 
         max = right;
 
       /* If the maximum value is already in element I, we're
@@ -117,38 +159,209 @@ heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
         break;
 
       /* Swap and continue down the heap. */
-      do_swap (array, i, max, size);
+      swap (base + i * size, base + max * size, size);
       i = max;
     }
 }
 
+/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
+   by heap sort.  Arguments are as for insertion_sort(). */
+static void
+heap_sort (unsigned char *array, size_t cnt, size_t size,
+           int (*compare) (const void *, const void *, void *aux),
+           void *aux, swap_func *swap)
+{
+  size_t i;
+
+  /* Build a heap. */
+  for (i = cnt / 2; i > 0; i--)
+    heapify (array, i, cnt, size, compare, aux, swap);
+
+  /* Sort the heap. */
+  for (i = cnt; i > 1; i--) 
+    {
+      swap (array, array + (i - 1) * size, size);
+      heapify (array, 1, i - 1, size, compare, aux, swap); 
+    }
+}
+
+/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
+   by quicksort, switching to heap sort once DEPTH levels of
+   partitioning have not finished the job.  Other arguments are
+   as for insertion_sort(). */
+static void
+intro_sort (unsigned char *array, size_t cnt, size_t size, int depth,
+            int (*compare) (const void *, const void *, void *aux),
+            void *aux, swap_func *swap)
+{
+  while (cnt > INSERTION_CNT)
+    {
+      unsigned char *first = array;
+      unsigned char *middle = array + cnt / 2 * size;
+      unsigned char *last = array + (cnt - 1) * size;
+      unsigned char *i, *j;
+      size_t left_cnt, right_cnt;
+
+      if (depth-- == 0)
+        {
+          heap_sort (array, cnt, size, compare, aux, swap);
+          return;
+        }
+
+      /* Order the first, middle, and last elements, then use the
+         median of the three, moved to the front, as the pivot.
+         That leaves an element no greater than the pivot in the
+         middle and one no less than it at the end, which stop
+         the scans below without bounds checks. */
+      if (compare (middle, first, aux) < 0)
+        swap (middle, first, size);
+      if (compare (last, middle, aux) < 0)
+        {
+          swap (last, middle, size);
+          if (compare (middle, first, aux) < 0)
+            swap (middle, first, size);
+        }
+      swap (first, middle, size);
+
+      /* Partition the rest around the pivot.  Both scans stop at
+         elements equal to the pivot, so that arrays with many
+         equal elements still split evenly. */
+      i = first;
+      j = last + size;
+      for (;;)
+        {
+          do
+            i += size;
+          while (compare (i, first, aux) < 0);
+          do
+            j -= size;
+          while (compare (first, j, aux) < 0);
+          if (i >= j)
+            break;
+          swap (i, j, size);
+        }
+      swap (first, j, size);
+
+      /* Recurse into the smaller side and loop on the larger, to
+         bound the stack depth by lg CNT. */
+      left_cnt = (j - first) / size;
+      right_cnt = cnt - left_cnt - 1;
+      if (left_cnt < right_cnt)
+        {
+          intro_sort (array, left_cnt, size, depth, compare, aux, swap);
+          array = j + size;
+          cnt = right_cnt;
+        }
+      else
+        {
+          intro_sort (j + size, right_cnt, size, depth, compare, aux, swap);
+          cnt = left_cnt;
+        }
+    }
+  insertion_sort (array, cnt, size, compare, aux, swap);
+}
+
 /* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
    using COMPARE to compare elements, passing AUX as auxiliary
    data.  When COMPARE is passed a pair of elements A and B,
    respectively, it must return a strcmp()-type result, i.e. less
    than zero if A < B, zero if A == B, greater than zero if A >
-   B.  Runs in O(n lg n) time and O(1) space in CNT. */
+   B.  Runs in O(n lg n) time and O(lg n) space in CNT.
+
+   This is an introsort: a quicksort with median-of-three
+   pivots, which hands small partitions to insertion sort and
+   falls back to heap sort if partitioning goes badly. */
 void
 sort (void *array, size_t cnt, size_t size,
       int (*compare) (const void *, const void *, void *aux),
       void *aux) 
 {
+  int depth;
   size_t i;
 
   ASSERT (array != NULL || cnt == 0);
   ASSERT (compare != NULL);
   ASSERT (size > 0);
 
-  /* Build a heap. */
-  for (i = cnt / 2; i > 0; i--)
-    heapify (array, i, cnt, size, compare, aux);
+  /* Allow 2 * lg CNT levels of partitioning. */
+  depth = 0;
+  for (i = cnt; i > 1; i /= 2)
+    depth += 2;
 
-  /* Sort the heap. */
-  for (i = cnt; i > 1; i--) 
+  intro_sort (array, cnt, size, depth, compare, aux,
+              choose_swap (array, size));
+}
+
+/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
+   by merge sort, using BUF as scratch space.  Other arguments
+   are as for insertion_sort(). */
+static void
+merge_sort (unsigned char *array, size_t cnt, size_t size,
+            int (*compare) (const void *, const void *, void *aux),
+            void *aux, swap_func *swap, unsigned char *buf)
+{
+  size_t left_cnt = cnt / 2;
+  unsigned char *right = array + left_cnt * size;
+  unsigned char *end = array + cnt * size;
+  unsigned char *a, *a_end, *b, *out;
+
+  if (cnt <= INSERTION_CNT)
     {
-      do_swap (array, 1, i, size);
-      heapify (array, 1, i - 1, size, compare, aux); 
+      insertion_sort (array, cnt, size, compare, aux, swap);
+      return;
     }
+
+  merge_sort (array, left_cnt, size, compare, aux, swap, buf);
+  merge_sort (right, cnt - left_cnt, size, compare, aux, swap, buf);
+
+  /* Nothing to do if the halves are already in order. */
+  if (compare (right - size, right, aux) <= 0)
+    return;
+
+  /* Move the left half aside, then merge it with the right half
+     into ARRAY.  The output never overtakes the unread part of
+     the right half.  Taking from the left half on ties keeps the
+     sort stable. */
+  memcpy (buf, array, left_cnt * size);
+  a = buf;
+  a_end = buf + left_cnt * size;
+  b = right;
+  out = array;
+  while (a < a_end && b < end)
+    {
+      if (compare (b, a, aux) < 0)
+        {
+          memcpy (out, b, size);
+          b += size;
+        }
+      else
+        {
+          memcpy (out, a, size);
+          a += size;
+        }
+      out += size;
+    }
+  memcpy (out, a, a_end - a);
+}
+
+/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
+   using COMPARE to compare elements, passing AUX as auxiliary
+   data, like sort(), except that elements that compare equal
+   keep their original order.  BUF must point to scratch space
+   for at least CNT / 2 elements.  Runs in O(n lg n) time and
+   O(lg n) space in CNT, besides BUF. */
+void
+stable_sort (void *array, size_t cnt, size_t size,
+             int (*compare) (const void *, const void *, void *aux),
+             void *aux, void *buf) 
+{
+  ASSERT (array != NULL || cnt == 0);
+  ASSERT (buf != NULL || cnt / 2 == 0);
+  ASSERT (compare != NULL);
+  ASSERT (size > 0);
+
+  merge_sort (array, cnt, size, compare, aux, choose_swap (array, size),
+              buf);
 }
 
 /* Searches ARRAY, which contains CNT elements of SIZE bytes
@@ -14,6 +14,9 @@ void *bsearch (const void *key, const void *array, size_t cnt,
 void sort (void *array, size_t cnt, size_t size,
            int (*compare) (const void *, const void *, void *aux),
            void *aux);
+void stable_sort (void *array, size_t cnt, size_t size,
+                  int (*compare) (const void *, const void *, void *aux),
+                  void *aux, void *buf);
 void *binary_search (const void *key, const void *array, size_t cnt,
                      size_t size,
                      int (*compare) (const void *, const void *, void *aux),
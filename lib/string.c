@@ -1,54 +1,159 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* Block operations below STRING_MIN bytes are done a byte at a
+   time.  Larger ones are done a word at a time, switching to a
+   string instruction only once the block is big enough to repay
+   the instruction's startup cost, which tests/internal/string.c
+   measures at a few hundred cycles.  REP STOSL catches up with a
+   word loop sooner than REP MOVSL does, and REP MOVSL with the
+   direction flag set, as memmove() uses it, later still. */
+#define STRING_MIN 16
+#define MOVS_MIN 1024
+#define STOS_MIN 256
+#define MOVS_BACK_MIN 4096
+
+/* A 32-bit word that may alias any other type. */
+typedef uint32_t __attribute__ ((may_alias)) word_t;
+
+/* Evaluates to nonzero if any byte in word X is zero.
+
+   The string functions below read strings a word at a time once
+   they reach a word boundary.  An aligned word never straddles a
+   page boundary, so these reads never touch a page that the
+   string itself does not reach, even if they pass its null
+   terminator. */
+#define HAS_ZERO(X) (((X) - 0x01010101u) & ~(X) & 0x80808080u)
+
+/* Returns a word with each byte set to C. */
+#define WORD_OF(C) ((unsigned char) (C) * 0x01010101u)
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
-   Returns DST. */
+   Returns DST.
+
+   Sizable copies first copy enough bytes to align DST to a word
+   boundary, then copy whole words, four per iteration for
+   mid-size blocks and with REP MOVSL for large ones, and then
+   the last few bytes.  The MMX and SSE registers are not used,
+   because the kernel runs with CR0.EM set and never saves or
+   restores FPU state. */
 void *
 memcpy (void *dst_, const void *src_, size_t size) 
 {
   unsigned char *dst = dst_;
   const unsigned char *src = src_;
+  size_t head, words;
 
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
+  if (size < STRING_MIN) 
+    {
+      while (size-- > 0)
+        *dst++ = *src++;
+      return dst_;
+    }
+
+  head = -(uintptr_t) dst & 3;
+  words = (size - head) / 4;
+  size = (size - head) % 4;
+  if (words * 4 < MOVS_MIN) 
+    {
+      word_t *d;
+      const word_t *s;
+
+      for (; head > 0; head--)
+        *dst++ = *src++;
+      d = (word_t *) dst;
+      s = (const word_t *) src;
+      for (; words >= 4; words -= 4, d += 4, s += 4) 
+        {
+          d[0] = s[0];
+          d[1] = s[1];
+          d[2] = s[2];
+          d[3] = s[3];
+        }
+      while (words-- > 0)
+        *d++ = *s++;
+      dst = (unsigned char *) d;
+      src = (const unsigned char *) s;
+      while (size-- > 0)
+        *dst++ = *src++;
+      return dst_;
+    }
+
+  asm volatile ("rep movsb; movl %3, %%ecx; rep movsl; movl %4, %%ecx; "
+                "rep movsb"
+                : "+D" (dst), "+S" (src), "+c" (head)
+                : "r" (words), "r" (size)
+                : "memory");
 
   return dst_;
 }
 
 /* Copies SIZE bytes from SRC to DST, which are allowed to
-   overlap.  Returns DST. */
+   overlap.  Returns DST.  Copies forward with memcpy() unless
+   DST overlaps the end of SRC, in which case it copies backward:
+   a byte at a time for small blocks, a word at a time for
+   mid-size ones, and with REP MOVSL and the direction flag set
+   for large ones. */
 void *
 memmove (void *dst_, const void *src_, size_t size) 
 {
   unsigned char *dst = dst_;
   const unsigned char *src = src_;
+  size_t words;
 
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
+  if (dst <= src || dst >= src + size)
+    return memcpy (dst, src, size);
+
+  dst += size;
+  src += size;
+  if (size < STRING_MIN) 
     {
       while (size-- > 0)
-        *dst++ = *src++;
+        *--dst = *--src;
+      return dst_;
+    }
+
+  for (; size % 4 != 0; size--)
+    *--dst = *--src;
+  words = size / 4;
+  if (size < MOVS_BACK_MIN) 
+    {
+      /* Each word is read before any part of it is overwritten,
+         because DST is above SRC. */
+      while (words-- > 0) 
+        {
+          dst -= 4;
+          src -= 4;
+          *(word_t *) dst = *(const word_t *) src;
+        }
     }
   else 
     {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
+      dst -= 4;
+      src -= 4;
+      asm volatile ("std; rep movsl; cld"
+                    : "+D" (dst), "+S" (src), "+c" (words)
+                    :
+                    : "memory");
     }
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
    at A and B.  Returns a positive value if the byte in A is
    greater, a negative value if the byte in B is greater, or zero
-   if blocks A and B are equal. */
+   if blocks A and B are equal.  Equal words are skipped a word
+   at a time, which takes half the byte-wise time at 32 bytes and
+   about a quarter from 512 bytes up, so there is no
+   string-instruction path. */
 int
 memcmp (const void *a_, const void *b_, size_t size) 
 {
@@ -58,6 +163,9 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  for (; size >= 4 && *(const word_t *) a == *(const word_t *) b;
+       a += 4, b += 4, size -= 4)
+    continue;
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -78,6 +186,18 @@ strcmp (const char *a_, const char *b_)
   ASSERT (a != NULL);
   ASSERT (b != NULL);
 
+  /* If A and B are equally aligned, compare a word at a time up
+     to the first word that differs or holds a null terminator. */
+  if (((uintptr_t) a ^ (uintptr_t) b) % 4 == 0) 
+    {
+      for (; (uintptr_t) a % 4 != 0; a++, b++)
+        if (*a == '\0' || *a != *b)
+          return *a < *b ? -1 : *a > *b;
+      for (; (*(const word_t *) a == *(const word_t *) b
+              && !HAS_ZERO (*(const word_t *) a)); a += 4, b += 4)
+        continue;
+    }
+
   while (*a != '\0' && *a == *b) 
     {
       a++;
@@ -113,9 +233,22 @@ char *
 strchr (const char *string, int c_) 
 {
   char c = c_;
+  uint32_t cs = WORD_OF (c);
 
   ASSERT (string != NULL);
 
+  for (; (uintptr_t) string % 4 != 0; string++)
+    if (*string == c)
+      return (char *) string;
+    else if (*string == '\0')
+      return NULL;
+  for (;; string += 4) 
+    {
+      uint32_t w = *(const word_t *) string;
+      if (HAS_ZERO (w) || HAS_ZERO (w ^ cs))
+        break;
+    }
+
   for (;;) 
     if (*string == c)
       return (char *) string;
@@ -274,16 +407,46 @@ strtok_r (char *s, const char *delimiters, char **save_ptr)
   return token;
 }
 
-/* Sets the SIZE bytes in DST to VALUE. */
+/* Sets the SIZE bytes in DST to VALUE.  Like memcpy(), stores
+   whole words once DST is aligned, using REP STOSL only for large
+   blocks. */
 void *
 memset (void *dst_, int value, size_t size) 
 {
   unsigned char *dst = dst_;
+  uint32_t word = (unsigned char) value * 0x01010101u;
+  size_t head, words;
 
   ASSERT (dst != NULL || size == 0);
   
-  while (size-- > 0)
-    *dst++ = value;
+  if (size < STRING_MIN) 
+    {
+      while (size-- > 0)
+        *dst++ = value;
+      return dst_;
+    }
+
+  head = -(uintptr_t) dst & 3;
+  words = (size - head) / 4;
+  size = (size - head) % 4;
+  if (words * 4 < STOS_MIN) 
+    {
+      word_t *d;
+
+      for (; head > 0; head--)
+        *dst++ = value;
+      for (d = (word_t *) dst; words > 0; words--)
+        *d++ = word;
+      for (dst = (unsigned char *) d; size > 0; size--)
+        *dst++ = value;
+      return dst_;
+    }
+
+  asm volatile ("rep stosb; movl %2, %%ecx; rep stosl; movl %3, %%ecx; "
+                "rep stosb"
+                : "+D" (dst), "+c" (head)
+                : "r" (words), "r" (size), "a" (word)
+                : "memory");
 
   return dst_;
 }
@@ -293,10 +456,16 @@ size_t
 strlen (const char *string) 
 {
   const char *p;
+  const word_t *w;
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
+  for (p = string; (uintptr_t) p % 4 != 0; p++)
+    if (*p == '\0')
+      return p - string;
+  for (w = (const word_t *) p; !HAS_ZERO (*w); w++)
+    continue;
+  for (p = (const char *) w; *p != '\0'; p++)
     continue;
   return p - string;
 }
@@ -308,7 +477,16 @@ strnlen (const char *string, size_t maxlen)
 {
   size_t length;
 
-  for (length = 0; string[length] != '\0' && length < maxlen; length++)
+  /* Words are only read while they lie wholly within the first
+     MAXLEN bytes, which need not be null-terminated. */
+  for (length = 0; length < maxlen && (uintptr_t) (string + length) % 4 != 0;
+       length++)
+    if (string[length] == '\0')
+      return length;
+  while (maxlen - length >= 4
+         && !HAS_ZERO (*(const word_t *) (string + length)))
+    length += 4;
+  for (; length < maxlen && string[length] != '\0'; length++)
     continue;
   return length;
 }
@@ -0,0 +1,138 @@
+/* Test program for lib/kernel/bitmap.c.
+
+   Checks bitmap_scan() and bitmap_scan_and_flip_next() against a
+   simple bit-at-a-time scan on a bitmap of about a million bits
+   filled with random runs, then times first-fit and next-fit
+   allocation of single bits and of small groups.  Does both
+   for a plain bitmap and for one with a summary.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/cycles.h"
+#include "threads/test.h"
+
+/* Number of bits in the bitmap. */
+#define BIT_CNT (1024 * 1024)
+
+/* Number of scans checked and timed. */
+#define SCAN_CNT 64
+
+static void test_flags (enum bitmap_flags);
+static void fill (struct bitmap *, int percent);
+static size_t ref_scan (const struct bitmap *, size_t start, size_t cnt,
+                        bool);
+
+/* Tests bitmap scanning. */
+void
+test (void)
+{
+  test_flags (0);
+  test_flags (BITMAP_SUMMARY);
+  printf ("bitmap: PASS\n");
+}
+
+/* Tests scanning a bitmap created with FLAGS. */
+static void
+test_flags (enum bitmap_flags flags)
+{
+  static const size_t cnts[] = {1, 2, 8, 64};
+  struct bitmap *b = bitmap_create_flags (BIT_CNT, flags);
+  int percent;
+  size_t i;
+
+  ASSERT (b != NULL);
+
+  printf ("%s bitmap:\n", flags & BITMAP_SUMMARY ? "summary" : "plain");
+  printf ("checking scans at various densities:");
+  for (percent = 0; percent <= 100; percent += 25)
+    {
+      printf (" %d%%", percent);
+      fill (b, percent);
+      for (i = 0; i < SCAN_CNT; i++)
+        {
+          size_t start = random_ulong () % BIT_CNT;
+          size_t cnt = cnts[i % 4];
+          bool value = i % 2;
+
+          ASSERT (bitmap_scan (b, start, cnt, value)
+                  == ref_scan (b, start, cnt, value));
+        }
+    }
+  printf (" done\n");
+
+  printf ("cycles per allocation, 90%% full map (first-fit/next-fit):\n");
+  for (i = 0; i < sizeof cnts / sizeof *cnts; i++)
+    {
+      uint64_t start, first, next;
+      size_t j, idx;
+
+      fill (b, 90);
+      start = rdtsc ();
+      for (j = 0; j < SCAN_CNT; j++)
+        {
+          idx = bitmap_scan_and_flip (b, 0, cnts[i], false);
+          ASSERT (idx != BITMAP_ERROR);
+        }
+      first = cycles_per (start, SCAN_CNT);
+
+      fill (b, 90);
+      start = rdtsc ();
+      for (j = 0; j < SCAN_CNT; j++)
+        {
+          idx = bitmap_scan_and_flip_next (b, cnts[i], false);
+          ASSERT (idx != BITMAP_ERROR);
+          ASSERT (bitmap_all (b, idx, cnts[i]));
+        }
+      next = cycles_per (start, SCAN_CNT);
+
+      printf ("  %2zu bits: %llu/%llu\n", cnts[i], first, next);
+    }
+
+  bitmap_destroy (b);
+}
+
+/* Sets about PERCENT percent of the bits in B, in runs of random
+   length. */
+static void
+fill (struct bitmap *b, int percent)
+{
+  size_t i = 0;
+
+  while (i < BIT_CNT)
+    {
+      size_t run = random_ulong () % 128 + 1;
+      bool value = (int) (random_ulong () % 100) < percent;
+
+      if (run > BIT_CNT - i)
+        run = BIT_CNT - i;
+      bitmap_set_multiple (b, i, run, value);
+      i += run;
+    }
+}
+
+/* Finds the first group of CNT bits in B at or after START that
+   are all set to VALUE by testing one bit at a time, for
+   reference. */
+static size_t
+ref_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t run = 0;
+  size_t i;
+
+  if (cnt == 0)
+    return start;
+  for (i = start; i < bitmap_size (b); i++)
+    if (bitmap_test (b, i) != value)
+      run = 0;
+    else if (++run == cnt)
+      return i + 1 - cnt;
+  return BITMAP_ERROR;
+}
@@ -0,0 +1,213 @@
+/* Test program for the hash functions in lib/kernel/hash.c.
+
+   Checks hash_bytes() against published MurmurHash3 values and
+   checks that its result does not depend on the alignment of the
+   buffer, and checks hash_int() against FNV-1.  Then times
+   hash_bytes() against byte-wise FNV-1 for buffers from 4 bytes
+   to 4 kB.  Finally, fills hash tables with sequential page
+   numbers, as the supplemental page table does, and with page
+   addresses, and prints how long the bucket chains grow with
+   hash_int() and with hash_bytes().
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cycles.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+
+/* Largest buffer hashed. */
+#define MAX_SIZE 4096
+
+/* Number of calls timed for each size. */
+#define BENCH_ITERS 256
+
+/* Number of keys put in each table. */
+#define KEY_CNT 4096
+
+/* Chains at least this long are counted together. */
+#define MAX_CHAIN 8
+
+/* A key in a hash table. */
+struct key
+  {
+    struct hash_elem elem;      /* Hash element. */
+    uintptr_t value;            /* Page number or address. */
+  };
+
+static struct key keys[KEY_CNT];
+
+/* Keeps timed calls from being optimized away. */
+static volatile unsigned sink;
+
+static void verify (void);
+static void bench (size_t size);
+static void chains (const char *name, hash_hash_func *, uintptr_t scale);
+static hash_hash_func key_hash_int, key_hash_bytes;
+static hash_less_func key_less;
+static unsigned ref_hash_bytes (const void *, size_t);
+
+/* Tests the hash functions. */
+void
+test (void)
+{
+  size_t size;
+
+  printf ("checking hash_bytes()...");
+  verify ();
+  printf (" done\n");
+
+  printf ("cycles per call (hash_bytes/FNV-1):\n");
+  for (size = 4; size <= MAX_SIZE; size *= 4)
+    bench (size);
+
+  printf ("chain lengths for %d sequential keys:\n", KEY_CNT);
+  printf ("%-24s", "");
+  for (size = 0; size < MAX_CHAIN; size++)
+    printf (" %5zu", size);
+  printf ("    %zu+\n", size);
+  chains ("page numbers, hash_int", key_hash_int, 1);
+  chains ("page numbers, hash_bytes", key_hash_bytes, 1);
+  chains ("addresses, hash_int", key_hash_int, PGSIZE);
+  chains ("addresses, hash_bytes", key_hash_bytes, PGSIZE);
+  printf ("hash: PASS\n");
+}
+
+/* Checks hash_bytes() against known MurmurHash3 values, and
+   checks that it gives the same result for the same bytes at
+   every alignment.  Checks that hash_int() is FNV-1 of the
+   integer's bytes. */
+static void
+verify (void)
+{
+  static uint8_t buf[MAX_SIZE + 8];
+  const char *fox = "The quick brown fox jumps over the lazy dog";
+  size_t size;
+  int i;
+
+  ASSERT (hash_bytes ("", 0) == 0);
+  ASSERT (hash_string ("") == 0);
+  ASSERT (hash_string ("hello") == 0x248bfa47);
+  ASSERT (hash_bytes (fox, strlen (fox)) == 0x2e4ff723);
+  ASSERT (hash_string (fox) == 0x2e4ff723);
+
+  for (size = 0; size <= 64; size++)
+    {
+      unsigned hash;
+      int ofs;
+
+      random_bytes (buf, size);
+      hash = hash_bytes (buf, size);
+      for (ofs = 1; ofs < 8; ofs++)
+        {
+          memmove (buf + ofs, buf + ofs - 1, size);
+          ASSERT (hash_bytes (buf + ofs, size) == hash);
+        }
+    }
+
+  for (i = -1000; i < 1000; i++)
+    ASSERT (hash_int (i) == ref_hash_bytes (&i, sizeof i));
+  i = (int) random_ulong ();
+  ASSERT (hash_int (i) == ref_hash_bytes (&i, sizeof i));
+}
+
+/* Times hash_bytes() and FNV-1 on a misaligned buffer of SIZE
+   bytes and prints the average cycle counts. */
+static void
+bench (size_t size)
+{
+  static uint8_t buf[MAX_SIZE + 1];
+  uint64_t start, new, ref;
+  int i;
+
+  random_bytes (buf, sizeof buf);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_ITERS; i++)
+    sink = hash_bytes (buf + 1, size);
+  new = cycles_per (start, BENCH_ITERS);
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_ITERS; i++)
+    sink = ref_hash_bytes (buf + 1, size);
+  ref = cycles_per (start, BENCH_ITERS);
+
+  printf ("%6zu %6llu/%-6llu\n", size, new, ref);
+}
+
+/* Inserts keys 0, SCALE, 2 * SCALE, ... into a hash table that
+   hashes with HASH and prints the distribution of its bucket
+   chain lengths on a line labeled NAME. */
+static void
+chains (const char *name, hash_hash_func *hash, uintptr_t scale)
+{
+  size_t counts[MAX_CHAIN + 1];
+  struct hash h;
+  size_t i;
+
+  ASSERT (hash_init (&h, hash, key_less, NULL));
+  for (i = 0; i < KEY_CNT; i++)
+    {
+      keys[i].value = i * scale;
+      ASSERT (hash_insert (&h, &keys[i].elem) == NULL);
+    }
+
+  memset (counts, 0, sizeof counts);
+  for (i = 0; i < h.bucket_cnt; i++)
+    {
+      size_t len = list_size (&h.buckets[i]);
+      counts[len < MAX_CHAIN ? len : MAX_CHAIN]++;
+    }
+
+  printf ("%-24s", name);
+  for (i = 0; i <= MAX_CHAIN; i++)
+    printf (" %5zu", counts[i]);
+  printf ("\n");
+
+  hash_destroy (&h, NULL);
+}
+
+/* Returns hash_int() of E's value. */
+static unsigned
+key_hash_int (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct key, elem)->value);
+}
+
+/* Returns hash_bytes() of E's value. */
+static unsigned
+key_hash_bytes (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct key *k = hash_entry (e, struct key, elem);
+  return hash_bytes (&k->value, sizeof k->value);
+}
+
+/* Returns true if A's value is less than B's. */
+static bool
+key_less (const struct hash_elem *a, const struct hash_elem *b,
+          void *aux UNUSED)
+{
+  return (hash_entry (a, struct key, elem)->value
+          < hash_entry (b, struct key, elem)->value);
+}
+
+/* Fowler-Noll-Vo 32-bit hash, the former hash_bytes(), for
+   reference. */
+static unsigned
+ref_hash_bytes (const void *buf_, size_t size)
+{
+  const unsigned char *buf = buf_;
+  unsigned hash = 2166136261u;
+
+  while (size-- > 0)
+    hash = (hash * 16777619u) ^ *buf++;
+  return hash;
+}
@@ -0,0 +1,241 @@
+/* Test program for lib/kernel/pheap.c.
+
+   Runs random insertions, removals, decreases, and merges
+   against a pair of pairing heaps, checking the heaps' structure
+   after each one and checking each minimum against a scan of
+   all the elements, then times draining a heap against draining
+   a list with list_min().
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <list.h>
+#include <pheap.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/cycles.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Number of elements. */
+#define ELEM_CNT 256
+
+/* Number of random operations. */
+#define OP_CNT 20000
+
+/* Largest number of elements timed. */
+#define MAX_BENCH 10000
+
+/* An element. */
+struct value
+  {
+    struct pheap_elem heap_elem;  /* Heap element. */
+    struct list_elem list_elem;   /* List element. */
+    int key;                      /* Sort key. */
+    int heap;                     /* Index of heap holding it, or -1. */
+  };
+
+static struct value values[ELEM_CNT];
+
+static pheap_less_func value_less;
+static list_less_func value_list_less;
+static void verify (struct pheap *, int idx);
+static size_t verify_subtree (struct pheap_elem *);
+static void bench (size_t cnt);
+
+/* Tests the pairing heap. */
+void
+test (void)
+{
+  struct pheap heaps[2];
+  size_t cnt;
+  int i;
+
+  printf ("testing random operations...");
+  pheap_init (&heaps[0], value_less, NULL);
+  pheap_init (&heaps[1], value_less, NULL);
+  for (i = 0; i < ELEM_CNT; i++)
+    values[i].heap = -1;
+
+  for (i = 0; i < OP_CNT; i++)
+    {
+      struct value *v = &values[random_ulong () % ELEM_CNT];
+      int h = random_ulong () % 2;
+      struct pheap_elem *e;
+
+      switch (random_ulong () % 5)
+        {
+        case 0:
+        case 1:
+          if (v->heap < 0)
+            {
+              v->key = random_ulong () % 1000;
+              v->heap = h;
+              pheap_insert (&heaps[h], &v->heap_elem);
+            }
+          else
+            {
+              v->key -= random_ulong () % 100;
+              pheap_decrease (&heaps[v->heap], &v->heap_elem);
+            }
+          break;
+
+        case 2:
+          if (!pheap_empty (&heaps[h]))
+            {
+              e = pheap_pop_min (&heaps[h]);
+              pheap_entry (e, struct value, heap_elem)->heap = -1;
+            }
+          break;
+
+        case 3:
+          if (v->heap >= 0)
+            {
+              pheap_remove (&heaps[v->heap], &v->heap_elem);
+              v->heap = -1;
+            }
+          break;
+
+        case 4:
+          if (random_ulong () % 16 == 0)
+            {
+              int j;
+
+              pheap_merge (&heaps[h], &heaps[!h]);
+              for (j = 0; j < ELEM_CNT; j++)
+                if (values[j].heap >= 0)
+                  values[j].heap = h;
+            }
+          break;
+        }
+
+      verify (&heaps[0], 0);
+      verify (&heaps[1], 1);
+    }
+  printf (" done\n");
+
+  printf ("cycles per element (list_min/pheap_pop_min):\n");
+  for (cnt = 10; cnt <= MAX_BENCH; cnt *= 10)
+    bench (cnt);
+
+  printf ("pheap: PASS\n");
+}
+
+/* Checks that H, whose index is IDX, is heap-ordered, that its
+   links are consistent, and that it holds the elements recorded
+   as being in it, with the smallest key at the root. */
+static void
+verify (struct pheap *h, int idx)
+{
+  struct value *min = NULL;
+  size_t cnt = 0;
+  int i;
+
+  for (i = 0; i < ELEM_CNT; i++)
+    if (values[i].heap == idx)
+      {
+        cnt++;
+        if (min == NULL || values[i].key < min->key)
+          min = &values[i];
+      }
+
+  ASSERT (pheap_size (h) == cnt);
+  ASSERT (pheap_empty (h) == (cnt == 0));
+  if (cnt == 0)
+    {
+      ASSERT (pheap_min (h) == NULL);
+    }
+  else
+    {
+      struct pheap_elem *root = pheap_min (h);
+      ASSERT (root->prev == NULL && root->next == NULL);
+      ASSERT (pheap_entry (root, struct value, heap_elem)->heap == idx);
+      ASSERT (pheap_entry (root, struct value, heap_elem)->key == min->key);
+      ASSERT (verify_subtree (root) == cnt);
+    }
+}
+
+/* Checks that each child of E is no smaller than E and links
+   back correctly, and returns the number of elements in the
+   subtree rooted at E. */
+static size_t
+verify_subtree (struct pheap_elem *e)
+{
+  const struct value *v = pheap_entry (e, struct value, heap_elem);
+  struct pheap_elem *c, *prev = e;
+  size_t cnt = 1;
+
+  for (c = e->child; c != NULL; prev = c, c = c->next)
+    {
+      ASSERT (c->prev == prev);
+      ASSERT (pheap_entry (c, struct value, heap_elem)->key >= v->key);
+      cnt += verify_subtree (c);
+    }
+  return cnt;
+}
+
+/* Times filling a list with CNT elements with random keys and
+   removing them in order with list_min(), and the same for a
+   heap, and prints the cycle counts per element. */
+static void
+bench (size_t cnt)
+{
+  struct value *elems = malloc (cnt * sizeof *elems);
+  struct list list;
+  struct pheap heap;
+  uint64_t start, list_time, heap_time;
+  size_t i;
+
+  if (elems == NULL)
+    {
+      printf ("%6zu: out of memory\n", cnt);
+      return;
+    }
+  for (i = 0; i < cnt; i++)
+    elems[i].key = random_ulong () % cnt;
+
+  start = rdtsc ();
+  list_init (&list);
+  for (i = 0; i < cnt; i++)
+    list_push_back (&list, &elems[i].list_elem);
+  while (!list_empty (&list))
+    list_remove (list_min (&list, value_list_less, NULL));
+  list_time = cycles_per (start, cnt);
+
+  start = rdtsc ();
+  pheap_init (&heap, value_less, NULL);
+  for (i = 0; i < cnt; i++)
+    pheap_insert (&heap, &elems[i].heap_elem);
+  while (!pheap_empty (&heap))
+    pheap_pop_min (&heap);
+  heap_time = cycles_per (start, cnt);
+
+  printf ("%6zu: %llu/%llu\n", cnt, list_time, heap_time);
+  free (elems);
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_less (const struct pheap_elem *a_, const struct pheap_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = pheap_entry (a_, struct value, heap_elem);
+  const struct value *b = pheap_entry (b_, struct value, heap_elem);
+
+  return a->key < b->key;
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_list_less (const struct list_elem *a_, const struct list_elem *b_,
+                 void *aux UNUSED)
+{
+  const struct value *a = list_entry (a_, struct value, list_elem);
+  const struct value *b = list_entry (b_, struct value, list_elem);
+
+  return a->key < b->key;
+}
@@ -0,0 +1,212 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Runs random insertions and removals against a red-black tree,
+   checking the tree's structure and order after each one and
+   checking that equal elements stay in insertion order.  Then
+   times filling and draining an ordered list, with
+   list_insert_ordered(), and a tree, with rb_insert(), for 10 to
+   10,000 elements.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <list.h>
+#include <random.h>
+#include <rbtree.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/cycles.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Number of elements in the checked tree. */
+#define ELEM_CNT 512
+
+/* Number of random operations on the checked tree. */
+#define OP_CNT 20000
+
+/* Largest number of elements timed. */
+#define MAX_BENCH 10000
+
+/* An element. */
+struct value
+  {
+    struct rb_elem rb_elem;     /* Tree element. */
+    struct list_elem list_elem; /* List element. */
+    int key;                    /* Sort key. */
+    int seq;                    /* Insertion sequence number. */
+    bool present;               /* In the tree? */
+  };
+
+static rb_less_func value_less;
+static list_less_func value_list_less;
+static void verify (struct rb_tree *, size_t cnt);
+static int verify_subtree (struct rb_elem *, struct rb_elem *parent);
+static void bench (size_t cnt);
+
+/* Tests the red-black tree. */
+void
+test (void)
+{
+  static struct value values[ELEM_CNT];
+  struct rb_tree tree;
+  size_t present = 0;
+  size_t cnt;
+  int seq = 0;
+  int i;
+
+  printf ("testing random insertions and removals...");
+  rb_init (&tree, value_less, NULL);
+  for (i = 0; i < ELEM_CNT; i++)
+    values[i].present = false;
+  for (i = 0; i < OP_CNT; i++)
+    {
+      struct value *v = &values[random_ulong () % ELEM_CNT];
+
+      if (!v->present)
+        {
+          /* Few distinct keys, so there are many equal ones. */
+          v->key = random_ulong () % 64;
+          v->seq = seq++;
+          rb_insert (&tree, &v->rb_elem);
+          v->present = true;
+          present++;
+        }
+      else if (random_ulong () % 2)
+        {
+          rb_remove (&tree, &v->rb_elem);
+          v->present = false;
+          present--;
+        }
+      else
+        {
+          struct value *first = rb_entry (rb_find (&tree, &v->rb_elem),
+                                          struct value, rb_elem);
+          ASSERT (first->key == v->key && first->seq <= v->seq);
+        }
+      verify (&tree, present);
+    }
+  while (!rb_empty (&tree))
+    {
+      struct rb_elem *e = rb_pop_first (&tree);
+      rb_entry (e, struct value, rb_elem)->present = false;
+      verify (&tree, --present);
+    }
+  printf (" done\n");
+
+  printf ("cycles per element (list_insert_ordered/rb_insert):\n");
+  for (cnt = 10; cnt <= MAX_BENCH; cnt *= 10)
+    bench (cnt);
+
+  printf ("rbtree: PASS\n");
+}
+
+/* Checks that T holds CNT elements in order, with equal elements
+   in insertion order, and that it is a valid red-black tree. */
+static void
+verify (struct rb_tree *t, size_t cnt)
+{
+  struct rb_elem *e, *prev = NULL;
+  size_t i = 0;
+
+  ASSERT (rb_size (t) == cnt);
+  ASSERT (rb_empty (t) == (cnt == 0));
+  ASSERT (t->root == NULL || !t->root->red);
+  verify_subtree (t->root, NULL);
+
+  for (e = rb_first (t); e != NULL; prev = e, e = rb_next (e), i++)
+    {
+      ASSERT (rb_entry (e, struct value, rb_elem)->present);
+      if (prev != NULL)
+        {
+          struct value *a = rb_entry (prev, struct value, rb_elem);
+          struct value *b = rb_entry (e, struct value, rb_elem);
+          ASSERT (a->key < b->key || (a->key == b->key && a->seq < b->seq));
+        }
+      ASSERT (rb_prev (e) == prev);
+    }
+  ASSERT (i == cnt);
+  ASSERT (rb_last (t) == prev);
+}
+
+/* Checks the parent links and colors in the subtree rooted at E,
+   whose parent is PARENT, and returns its black height. */
+static int
+verify_subtree (struct rb_elem *e, struct rb_elem *parent)
+{
+  int left, right;
+
+  if (e == NULL)
+    return 1;
+  ASSERT (e->parent == parent);
+  ASSERT (!e->red || (parent != NULL && !parent->red));
+  left = verify_subtree (e->left, e);
+  right = verify_subtree (e->right, e);
+  ASSERT (left == right);
+  return left + !e->red;
+}
+
+/* Times inserting CNT elements with random keys into an ordered
+   list and removing them again from the front, and the same for
+   a tree, and prints the cycle counts per element. */
+static void
+bench (size_t cnt)
+{
+  struct value *values = malloc (cnt * sizeof *values);
+  struct list list;
+  struct rb_tree tree;
+  uint64_t start, list_time, tree_time;
+  size_t i;
+
+  if (values == NULL)
+    {
+      printf ("%6zu: out of memory\n", cnt);
+      return;
+    }
+  for (i = 0; i < cnt; i++)
+    values[i].key = random_ulong () % cnt;
+
+  start = rdtsc ();
+  list_init (&list);
+  for (i = 0; i < cnt; i++)
+    list_insert_ordered (&list, &values[i].list_elem, value_list_less, NULL);
+  while (!list_empty (&list))
+    list_pop_front (&list);
+  list_time = cycles_per (start, cnt);
+
+  start = rdtsc ();
+  rb_init (&tree, value_less, NULL);
+  for (i = 0; i < cnt; i++)
+    rb_insert (&tree, &values[i].rb_elem);
+  while (!rb_empty (&tree))
+    rb_pop_first (&tree);
+  tree_time = cycles_per (start, cnt);
+
+  printf ("%6zu: %llu/%llu\n", cnt, list_time, tree_time);
+  free (values);
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_less (const struct rb_elem *a_, const struct rb_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = rb_entry (a_, struct value, rb_elem);
+  const struct value *b = rb_entry (b_, struct value, rb_elem);
+
+  return a->key < b->key;
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_list_less (const struct list_elem *a_, const struct list_elem *b_,
+                 void *aux UNUSED)
+{
+  const struct value *a = list_entry (a_, struct value, list_elem);
+  const struct value *b = list_entry (b_, struct value, list_elem);
+
+  return a->key < b->key;
+}
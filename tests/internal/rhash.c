@@ -0,0 +1,141 @@
+/* Test program for lib/kernel/rhash.c.
+
+   Runs random insertions, deletions, and lookups against an
+   rhash, checking every result against a record of which keys
+   are present, with keys that hash well and keys that all
+   collide in their low bits.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <rhash.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Number of distinct keys. */
+#define KEY_CNT 2048
+
+/* Number of random operations per round. */
+#define OP_CNT 50000
+
+/* An element. */
+struct value
+  {
+    struct hash_elem elem;      /* Hash element. */
+    int key;                    /* Key. */
+    bool present;               /* In the table? */
+  };
+
+static struct value values[KEY_CNT];
+
+static hash_hash_func value_hash, value_hash_clustered;
+static hash_less_func value_less;
+static hash_action_func count_value;
+static void run (hash_hash_func *);
+
+/* Tests the rhash implementation. */
+void
+test (void)
+{
+  printf ("testing well-spread hashes...");
+  run (value_hash);
+  printf (" done\n");
+  printf ("testing clustered hashes...");
+  run (value_hash_clustered);
+  printf (" done\n");
+  printf ("rhash: PASS\n");
+}
+
+/* Runs a round of random operations on a table that hashes with
+   HASH. */
+static void
+run (hash_hash_func *hash)
+{
+  struct rhash h;
+  size_t present = 0;
+  int count;
+  int i;
+
+  ASSERT (rhash_init (&h, hash, value_less, &count));
+  for (i = 0; i < KEY_CNT; i++)
+    {
+      values[i].key = i;
+      values[i].present = false;
+    }
+
+  for (i = 0; i < OP_CNT; i++)
+    {
+      struct value *v = &values[random_ulong () % KEY_CNT];
+      struct hash_elem *e;
+
+      switch (random_ulong () % 3)
+        {
+        case 0:
+          e = rhash_insert (&h, &v->elem);
+          ASSERT (v->present ? e == &v->elem : e == NULL);
+          if (!v->present)
+            present++;
+          v->present = true;
+          break;
+
+        case 1:
+          e = rhash_delete (&h, &v->elem);
+          ASSERT (v->present ? e == &v->elem : e == NULL);
+          if (v->present)
+            present--;
+          v->present = false;
+          break;
+
+        case 2:
+          e = rhash_find (&h, &v->elem);
+          ASSERT (v->present ? e == &v->elem : e == NULL);
+          break;
+        }
+      ASSERT (rhash_size (&h) == present);
+
+      if (i % 1000 == 0)
+        {
+          count = 0;
+          rhash_apply (&h, count_value);
+          ASSERT ((size_t) count == present);
+        }
+    }
+
+  rhash_destroy (&h, NULL);
+}
+
+/* Returns a hash of E's key. */
+static unsigned
+value_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct value, elem)->key);
+}
+
+/* Returns E's key shifted left, so that all hashes share their
+   low-order bits and collide. */
+static unsigned
+value_hash_clustered (const struct hash_elem *e, void *aux UNUSED)
+{
+  return (unsigned) hash_entry (e, struct value, elem)->key << 4;
+}
+
+/* Returns true if A's key is less than B's. */
+static bool
+value_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct value, elem)->key
+          < hash_entry (b, struct value, elem)->key);
+}
+
+/* Counts E in the int that AUX points to. */
+static void
+count_value (struct hash_elem *e UNUSED, void *aux)
+{
+  int *count = aux;
+  (*count)++;
+}
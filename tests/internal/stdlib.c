@@ -1,7 +1,10 @@
 /* Test program for sorting and searching in lib/stdlib.c.
 
    Attempts to test the sorting and searching functionality that
-   is not sufficiently tested elsewhere in Pintos.
+   is not sufficiently tested elsewhere in Pintos.  Also checks
+   that stable_sort() keeps equal elements in order, and times
+   sort() and stable_sort() against a plain heap sort on arrays
+   of 1K to 1M elements.
 
    This is not a test we will run on your submitted projects.
    It is here for completeness.
@@ -11,8 +14,11 @@
 #include <debug.h>
 #include <limits.h>
 #include <random.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include "threads/cycles.h"
+#include "threads/malloc.h"
 #include "threads/test.h"
 
 /* Maximum number of elements in an array that we will test. */
@@ -22,6 +28,12 @@ static void shuffle (int[], size_t);
 static int compare_ints (const void *, const void *);
 static void verify_order (const int[], size_t);
 static void verify_bsearch (const int[], size_t);
+static void verify_stable (size_t);
+static void bench (size_t);
+static int compare_keys (const void *, const void *, void *);
+static int compare_ints_aux (const void *, const void *, void *);
+static void ref_heap_sort (int[], size_t,
+                           int (*compare) (const void *, const void *));
 
 /* Test sorting and searching implementations. */
 void
@@ -53,6 +65,19 @@ test (void)
     }
   
   printf (" done\n");
+
+  printf ("testing stable sort:");
+  for (cnt = 0; cnt < MAX_CNT; cnt = cnt * 4 / 3 + 1)
+    {
+      printf (" %zu", cnt);
+      verify_stable (cnt);
+    }
+  printf (" done\n");
+
+  printf ("cycles per element (sort/stable_sort/heap sort):\n");
+  for (cnt = 1024; cnt <= 1024 * 1024; cnt *= 4)
+    bench (cnt);
+
   printf ("stdlib: PASS\n");
 }
 
@@ -71,6 +96,139 @@ shuffle (int *array, size_t cnt)
     }
 }
 
+/* An element for checking stability. */
+struct record
+  {
+    int key;                    /* Sort key, with many duplicates. */
+    int idx;                    /* Original position. */
+    char name[3];               /* Makes the size a non-multiple of 4. */
+  };
+
+/* Sorts CNT records with few distinct keys with stable_sort(),
+   then verifies that the keys are in order and that records with
+   equal keys are still in their original order. */
+static void
+verify_stable (size_t cnt) 
+{
+  static struct record records[MAX_CNT];
+  static struct record buf[MAX_CNT / 2];
+  size_t i;
+
+  for (i = 0; i < cnt; i++) 
+    {
+      records[i].key = random_ulong () % 16;
+      records[i].idx = i;
+    }
+  stable_sort (records, cnt, sizeof *records, compare_keys, NULL, buf);
+  for (i = 1; i < cnt; i++) 
+    {
+      ASSERT (records[i - 1].key <= records[i].key);
+      ASSERT (records[i - 1].key < records[i].key
+              || records[i - 1].idx < records[i].idx);
+    }
+}
+
+/* Times sort(), stable_sort(), and a heap sort on CNT random
+   ints and prints the cycle counts per element.  Skips arrays
+   that do not fit in memory. */
+static void
+bench (size_t cnt) 
+{
+  int *values = malloc (cnt * sizeof *values);
+  int *buf = malloc (cnt / 2 * sizeof *buf);
+  uint64_t t[3];
+  size_t i;
+  int j;
+
+  if (values == NULL || buf == NULL) 
+    {
+      printf ("%8zu: out of memory\n", cnt);
+      free (values);
+      free (buf);
+      return;
+    }
+
+  for (j = 0; j < 3; j++) 
+    {
+      uint64_t start;
+
+      for (i = 0; i < cnt; i++)
+        values[i] = i;
+      shuffle (values, cnt);
+
+      start = rdtsc ();
+      if (j == 0)
+        sort (values, cnt, sizeof *values, compare_ints_aux, NULL);
+      else if (j == 1)
+        stable_sort (values, cnt, sizeof *values, compare_ints_aux, NULL,
+                     buf);
+      else
+        ref_heap_sort (values, cnt, compare_ints);
+      t[j] = cycles_per (start, cnt);
+
+      verify_order (values, cnt);
+    }
+  printf ("%8zu: %llu/%llu/%llu\n", cnt, t[0], t[1], t[2]);
+
+  free (values);
+  free (buf);
+}
+
+/* Compares the keys of records A and B. */
+static int
+compare_keys (const void *a_, const void *b_, void *aux UNUSED) 
+{
+  const struct record *a = a_;
+  const struct record *b = b_;
+
+  return a->key < b->key ? -1 : a->key > b->key;
+}
+
+/* Compares ints *A and *B, for sort(). */
+static int
+compare_ints_aux (const void *a, const void *b, void *aux UNUSED) 
+{
+  return compare_ints (a, b);
+}
+
+/* Sorts the CNT ints in ARRAY by heap sort, the algorithm that
+   sort() used to use, comparing them with COMPARE, for
+   reference. */
+static void
+ref_heap_sort (int *array, size_t cnt,
+               int (*compare) (const void *, const void *)) 
+{
+  size_t i = cnt / 2, n = cnt;
+
+  for (;;)
+    {
+      size_t parent, child;
+      int t;
+
+      if (i > 0)
+        t = array[--i];
+      else if (n > 1)
+        {
+          t = array[--n];
+          array[n] = array[0];
+        }
+      else
+        break;
+
+      /* Float T down from I. */
+      for (parent = i; (child = 2 * parent + 1) < n; parent = child)
+        {
+          if (child + 1 < n
+              && compare (&array[child + 1], &array[child]) > 0)
+            child++;
+          if (compare (&array[child], &t) <= 0)
+            break;
+          array[parent] = array[child];
+        }
+      array[parent] = t;
+    }
+}
+
 /* Returns 1 if *A is greater than *B,
    0 if *A equals *B,
    -1 if *A is less than *B. */
@@ -0,0 +1,333 @@
+/* Test program for lib/string.c.
+
+   Checks memcpy(), memmove(), memset(), and memcmp() against
+   simple byte-at-a-time versions for every alignment of source
+   and destination, at sizes on both sides of each point where
+   they change strategy, then times both versions in the kernel
+   for block sizes from 1 byte to 4 kB.  Also checks strlen(),
+   strnlen(), strchr(), strcmp(), and strlcpy() against
+   byte-at-a-time versions on random strings, including strings
+   that end at the very end of a page.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cycles.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+
+/* Largest block tested. */
+#define MAX_SIZE 4096
+
+/* Number of calls timed for each size. */
+#define BENCH_ITERS 256
+
+static uint8_t buf_a[MAX_SIZE + 16];
+static uint8_t buf_b[MAX_SIZE + 16];
+static uint8_t buf_c[2 * MAX_SIZE + 16];
+
+/* Keeps timed memcmp() calls from being optimized away. */
+static volatile int sink;
+
+static void *ref_memcpy (void *, const void *, size_t);
+static void *ref_memmove (void *, const void *, size_t);
+static void *ref_memset (void *, int, size_t);
+static int ref_memcmp (const void *, const void *, size_t);
+static size_t ref_strlen (const char *);
+static size_t ref_strnlen (const char *, size_t);
+static char *ref_strchr (const char *, int);
+static int ref_strcmp (const char *, const char *);
+static void verify (size_t size);
+static void verify_strings (void);
+static void bench (size_t size);
+
+/* Tests the block functions. */
+void
+test (void)
+{
+  size_t size;
+
+  printf ("testing various block sizes:");
+  for (size = 0; size <= MAX_SIZE;
+       size = size < 64 || size % 2 ? size + 1 : size * 2 - 1)
+    {
+      printf (" %zu", size);
+      verify (size);
+    }
+  printf (" done\n");
+
+  printf ("testing string functions...");
+  verify_strings ();
+  printf (" done\n");
+
+  printf ("cycles per call (new/byte-wise):\n");
+  printf ("%6s %13s %13s %13s %13s\n",
+          "size", "memcpy", "memmove", "memset", "memcmp");
+  for (size = 1; size <= MAX_SIZE; size *= 2)
+    bench (size);
+  printf ("string: PASS\n");
+}
+
+/* Checks each block function with blocks of SIZE bytes at every
+   combination of source and destination alignment. */
+static void
+verify (size_t size)
+{
+  int src_ofs, dst_ofs;
+
+  for (src_ofs = 0; src_ofs < 4; src_ofs++)
+    for (dst_ofs = 0; dst_ofs < 4; dst_ofs++)
+      {
+        uint8_t *src = buf_a + src_ofs;
+        uint8_t *dst = buf_b + dst_ofs;
+        int delta;
+
+        random_bytes (buf_a, sizeof buf_a);
+        random_bytes (buf_b, sizeof buf_b);
+
+        /* memcpy() and memcmp(). */
+        ASSERT (memcpy (dst, src, size) == dst);
+        ASSERT (memcmp (dst, src, size) == 0);
+        ASSERT (ref_memcmp (dst, src, size) == 0);
+        if (size > 0)
+          {
+            size_t ofs = random_ulong () % size;
+            dst[ofs]++;
+            ASSERT (memcmp (dst, src, size) == ref_memcmp (dst, src, size));
+            ASSERT (memcmp (src, dst, size) == -memcmp (dst, src, size));
+          }
+
+        /* memset(), which must not touch the bytes around the
+           block. */
+        ref_memcpy (buf_a, buf_b, sizeof buf_a);
+        ASSERT (memset (dst, src_ofs * 0x55, size) == dst);
+        ref_memset (buf_a + dst_ofs, src_ofs * 0x55, size);
+        ASSERT (ref_memcmp (buf_a, buf_b, sizeof buf_a) == 0);
+
+        /* memmove() between overlapping blocks in both
+           directions. */
+        for (delta = -5; delta <= 5; delta++)
+          {
+            uint8_t *base = buf_c + MAX_SIZE / 2 + 8;
+            static uint8_t expect[sizeof buf_c];
+
+            random_bytes (buf_c, sizeof buf_c);
+            ref_memcpy (expect, buf_c, sizeof buf_c);
+            ref_memmove (expect + (base - buf_c) + src_ofs + delta,
+                         expect + (base - buf_c) + src_ofs, size);
+            ASSERT (memmove (base + src_ofs + delta, base + src_ofs, size)
+                    == base + src_ofs + delta);
+            ASSERT (ref_memcmp (buf_c, expect, sizeof buf_c) == 0);
+          }
+      }
+}
+
+/* Number of random strings to check. */
+#define STRING_CNT 20000
+
+/* Compares the string functions with their byte-at-a-time
+   versions on random strings at random alignments.  The strings
+   are drawn from small alphabets, so that comparisons often run
+   deep, and half of them end at the last byte of a page. */
+static void
+verify_strings (void)
+{
+  static char page[2 * PGSIZE] __attribute__ ((aligned (PGSIZE)));
+  static char other[PGSIZE];
+  static char dst[PGSIZE];
+  int i;
+
+  for (i = 0; i < STRING_CNT; i++)
+    {
+      size_t len = random_ulong () % 256;
+      size_t alphabet = random_ulong () % 4 + 1;
+      size_t maxlen = random_ulong () % 300;
+      size_t size = random_ulong () % 300;
+      char *a, *b;
+      int c;
+      size_t j;
+
+      if (i % 2)
+        a = page + PGSIZE - len - 1;
+      else
+        a = page + random_ulong () % 8;
+      b = other + random_ulong () % 8;
+
+      for (j = 0; j < len; j++)
+        a[j] = b[j] = 'a' + random_ulong () % alphabet;
+      a[len] = b[len] = '\0';
+      if (len > 0 && random_ulong () % 2)
+        b[random_ulong () % len] ^= random_ulong () % 3;
+      if (random_ulong () % 4 == 0)
+        b[random_ulong () % (len + 1)] = '\0';
+
+      ASSERT (strlen (a) == ref_strlen (a));
+      ASSERT (strnlen (a, maxlen) == ref_strnlen (a, maxlen));
+      ASSERT (strcmp (a, b) == ref_strcmp (a, b));
+      ASSERT (strcmp (b, a) == ref_strcmp (b, a));
+      c = random_ulong () % 8 == 0 ? '\0' : 'a' + random_ulong () % 5;
+      ASSERT (strchr (a, c) == ref_strchr (a, c));
+
+      memset (dst, 'x', sizeof dst);
+      ASSERT (strlcpy (dst + 1, a, size) == len);
+      if (size > 0)
+        {
+          size_t copied = len < size - 1 ? len : size - 1;
+          ASSERT (memcmp (dst + 1, a, copied) == 0);
+          ASSERT (dst[1 + copied] == '\0');
+          ASSERT (dst[2 + copied] == 'x');
+        }
+      else
+        ASSERT (dst[1] == 'x');
+    }
+}
+
+/* Times each block function, and its byte-wise version, on
+   misaligned blocks of SIZE bytes and prints the average cycle
+   counts. */
+static void
+bench (size_t size)
+{
+  uint64_t t[8];
+  int i;
+
+  memset (buf_a, 'x', sizeof buf_a);
+  memset (buf_b, 'x', sizeof buf_b);
+
+#define TIME(SLOT, CALL)                                \
+  do                                                    \
+    {                                                   \
+      uint64_t start = rdtsc ();                        \
+      for (i = 0; i < BENCH_ITERS; i++)                 \
+        CALL;                                           \
+      t[SLOT] = cycles_per (start, BENCH_ITERS);        \
+    }                                                   \
+  while (0)
+
+  TIME (0, memcpy (buf_b + 1, buf_a + 2, size));
+  TIME (1, ref_memcpy (buf_b + 1, buf_a + 2, size));
+  TIME (2, memmove (buf_a + 3, buf_a, size));
+  TIME (3, ref_memmove (buf_a + 3, buf_a, size));
+  TIME (4, memset (buf_b + 1, i, size));
+  TIME (5, ref_memset (buf_b + 1, i, size));
+  /* memset() has overwritten the block at BUF_B + 1, so copy it
+     back to make memcmp() compare all SIZE bytes. */
+  ref_memcpy (buf_b + 1, buf_a + 2, size);
+  TIME (6, sink = memcmp (buf_a + 2, buf_b + 1, size));
+  TIME (7, sink = ref_memcmp (buf_a + 2, buf_b + 1, size));
+#undef TIME
+
+  printf ("%6zu %6llu/%-6llu %6llu/%-6llu %6llu/%-6llu %6llu/%-6llu\n",
+          size, t[0], t[1], t[2], t[3], t[4], t[5], t[6], t[7]);
+}
+
+/* Byte-at-a-time versions, for reference. */
+
+static void *
+ref_memcpy (void *dst_, const void *src_, size_t size)
+{
+  volatile unsigned char *dst = dst_;
+  const unsigned char *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst_;
+}
+
+static void *
+ref_memmove (void *dst_, const void *src_, size_t size)
+{
+  volatile unsigned char *dst = dst_;
+  const unsigned char *src = src_;
+
+  if (dst < src)
+    {
+      while (size-- > 0)
+        *dst++ = *src++;
+    }
+  else
+    {
+      dst += size;
+      src += size;
+      while (size-- > 0)
+        *--dst = *--src;
+    }
+  return dst_;
+}
+
+static void *
+ref_memset (void *dst_, int value, size_t size)
+{
+  volatile unsigned char *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+  return dst_;
+}
+
+static int
+ref_memcmp (const void *a_, const void *b_, size_t size)
+{
+  const unsigned char *a = a_;
+  const unsigned char *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static size_t
+ref_strlen (const char *string)
+{
+  const char *p;
+
+  for (p = string; *p != '\0'; p++)
+    continue;
+  return p - string;
+}
+
+static size_t
+ref_strnlen (const char *string, size_t maxlen)
+{
+  size_t length;
+
+  for (length = 0; length < maxlen && string[length] != '\0'; length++)
+    continue;
+  return length;
+}
+
+static char *
+ref_strchr (const char *string, int c_)
+{
+  char c = c_;
+
+  for (;;)
+    if (*string == c)
+      return (char *) string;
+    else if (*string == '\0')
+      return NULL;
+    else
+      string++;
+}
+
+static int
+ref_strcmp (const char *a_, const char *b_)
+{
+  const unsigned char *a = (const unsigned char *) a_;
+  const unsigned char *b = (const unsigned char *) b_;
+
+  while (*a != '\0' && *a == *b)
+    {
+      a++;
+      b++;
+    }
+  return *a < *b ? -1 : *a > *b;
+}
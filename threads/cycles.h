@@ -0,0 +1,26 @@
+#ifndef THREADS_CYCLES_H
+#define THREADS_CYCLES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Returns the CPU's time-stamp counter, which counts CPU cycles.
+   See [IA32-v2b] "RDTSC--Read Time-Stamp Counter". */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns the average number of cycles taken by each of CNT
+   repetitions of an operation, which began when rdtsc() returned
+   START. */
+static inline uint64_t
+cycles_per (uint64_t start, size_t cnt)
+{
+  return (rdtsc () - start) / cnt;
+}
+
+#endif /* threads/cycles.h */
@@ -31,6 +31,15 @@
 #else
 #include "tests/threads/tests.h"
 #endif
+#ifdef VM
+#include "vm/fault.h"
+#include "vm/frame.h"
+#include "vm/image.h"
+#include "vm/merge.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
@@ -98,6 +107,10 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+#ifdef VM
+  frame_init ();
+  image_init ();
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -113,6 +126,7 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
@@ -126,6 +140,10 @@ main (void)
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
+#ifdef VM
+  swap_init ();
+  merge_init ();
+#endif
 
   printf ("Boot complete.\n");
   
@@ -150,15 +168,34 @@ bss_init (void)
   memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Returns true if the CPU supports 4 MB pages, as reported by
+   the PSE bit in the feature flags from CPUID.  See [IA32-v2a]
+   "CPUID--CPU Identification". */
+static bool
+cpu_has_pse (void) 
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return (edx & (1u << 3)) != 0;
+}
+
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports it, each 4 MB region of RAM that does not
+   contain kernel text is mapped with a single 4 MB page, which
+   saves its page table and takes one TLB entry instead of 1,024.
+   Other regions, including the one with the read-only kernel
+   text, are mapped with 4 kB pages through page tables. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
+  bool pse = cpu_has_pse ();
   extern char _start, _end_kernel_text;
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
@@ -171,6 +208,14 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (pse && pte_idx == 0 && page + PTSPAN / PGSIZE <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_large (vaddr, true);
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
@@ -180,6 +225,16 @@ paging_init (void)
       pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
     }
 
+  /* Enable 4 MB pages by setting CR4.PSE before the page
+     directory that uses them is loaded.  See [IA32-v3a] 3.6.1
+     "Paging Options". */
+  if (pse) 
+    {
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | (1u << 4)));
+    }
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -259,6 +314,25 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-sl"))
+        page_stack_limit = atoi (value);
+      else if (!strcmp (name, "-zswap"))
+        zswap_pages = atoi (value);
+      else if (!strcmp (name, "-merge"))
+        merge_rate = atoi (value);
+      else if (!strcmp (name, "-fstats"))
+        fault_stats_enabled = true;
+      else if (!strcmp (name, "-evict"))
+        {
+          if (!strcmp (value, "clock"))
+            frame_policy = FRAME_CLOCK;
+          else if (!strcmp (value, "wsclock"))
+            frame_policy = FRAME_WSCLOCK;
+          else
+            PANIC ("unknown replacement policy `%s'", value);
+        }
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -381,6 +455,13 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -sl=COUNT          Limit user stacks to COUNT pages.\n"
+          "  -zswap=PAGES       Keep up to PAGES pages of compressed swap in RAM.\n"
+          "  -merge=RATE        Merge identical pages, scanning RATE frames/s.\n"
+          "  -fstats            Print page fault stats when processes exit.\n"
+          "  -evict=POLICY      Replace pages by POLICY: wsclock or clock.\n"
 #endif
           );
   shutdown_power_off ();
@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,7 +24,19 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool also keeps a stack of pages that the idle thread has
+   already zeroed, so that most PAL_ZERO allocations of a single
+   page need not zero it themselves.  Once a stack drops below
+   ZEROED_LOW pages, the idle thread refills it up to ZEROED_HIGH
+   pages, one page at a time, whenever no other thread is ready
+   to run.  Pre-zeroed pages count as used, so a multi-page
+   request that finds no room first returns them to the pool. */
+
+/* Watermarks for each pool's stack of pre-zeroed pages. */
+#define ZEROED_LOW 8
+#define ZEROED_HIGH 32
 
 /* A memory pool. */
 struct pool
@@ -31,6 +44,13 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+
+    /* Pre-zeroed pages, linked through their first word, which
+       is cleared when a page is handed out.  Protected by
+       disabling interrupts. */
+    void *zeroed;                       /* Top of stack. */
+    size_t zeroed_cnt;                  /* Number of pages on stack. */
+    bool refilling;                     /* Refilling up to ZEROED_HIGH? */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +59,9 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static void *pop_zeroed (struct pool *);
+static bool release_zeroed (struct pool *);
+static bool prezero_page (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -77,12 +100,37 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
+  /* Prefer a page that is already zeroed. */
+  if (page_cnt == 1 && (flags & PAL_ZERO)) 
+    {
+      pages = pop_zeroed (pool);
+      if (pages != NULL)
+        return pages;
+    }
+
   lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  page_idx = bitmap_scan_and_flip_next (pool->used_map, page_cnt, false);
   lock_release (&pool->lock);
 
+  /* Pre-zeroed pages are marked used, so they may be what stands
+     in the way of a multi-page request.  Give them back and try
+     again. */
+  if (page_idx == BITMAP_ERROR && page_cnt > 1 && release_zeroed (pool))
+    {
+      lock_acquire (&pool->lock);
+      page_idx = bitmap_scan_and_flip_next (pool->used_map, page_cnt, false);
+      lock_release (&pool->lock);
+    }
+
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
+  else if (page_cnt == 1)
+    {
+      /* The pool is otherwise empty, so fall back on a pre-zeroed
+         page even if zeroing was not requested. */
+      pages = pop_zeroed (pool);
+      flags &= ~PAL_ZERO;
+    }
   else
     pages = NULL;
 
@@ -148,6 +196,25 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes one free page for later PAL_ZERO allocations, if a
+   pool's stack of pre-zeroed pages needs refilling.  Returns
+   true if a page was zeroed, false if there is nothing to do.
+   Called by the idle thread, so it never blocks. */
+bool
+palloc_prezero (void) 
+{
+  return prezero_page (&kernel_pool) || prezero_page (&user_pool);
+}
+
+/* Returns the number of pages in the user pool and stores the
+   kernel virtual address of its first page in *BASE. */
+size_t
+palloc_user_range (uint8_t **base) 
+{
+  *base = user_pool.base;
+  return bitmap_size (user_pool.used_map);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -156,7 +223,8 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   /* We'll put the pool's used_map at its base.
      Calculate the space needed for the bitmap
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt, BITMAP_SUMMARY),
+                                  PGSIZE);
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -165,8 +233,88 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
 
   /* Initialize the pool. */
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, BITMAP_SUMMARY, base,
+                                      bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
+  p->zeroed = NULL;
+  p->zeroed_cnt = 0;
+  p->refilling = true;
+}
+
+/* Removes a page from POOL's stack of pre-zeroed pages and
+   returns it, or returns a null pointer if the stack is
+   empty. */
+static void *
+pop_zeroed (struct pool *pool) 
+{
+  enum intr_level old_level = intr_disable ();
+  void **page = pool->zeroed;
+  if (page != NULL) 
+    {
+      pool->zeroed = *page;
+      pool->zeroed_cnt--;
+      *page = NULL;
+    }
+  intr_set_level (old_level);
+  return page;
+}
+
+/* Returns all the pages on POOL's stack of pre-zeroed pages to
+   POOL's free pages.  Returns true if there were any, false if
+   the stack was empty. */
+static bool
+release_zeroed (struct pool *pool) 
+{
+  bool released = false;
+  void *page;
+
+  while ((page = pop_zeroed (pool)) != NULL) 
+    {
+      size_t page_idx = pg_no (page) - pg_no (pool->base);
+
+      lock_acquire (&pool->lock);
+      ASSERT (bitmap_test (pool->used_map, page_idx));
+      bitmap_reset (pool->used_map, page_idx);
+      lock_release (&pool->lock);
+      released = true;
+    }
+  return released;
+}
+
+/* Allocates and zeroes one page from POOL and pushes it on
+   POOL's stack of pre-zeroed pages, if the stack is being
+   refilled.  Returns true if a page was zeroed, false
+   otherwise. */
+static bool
+prezero_page (struct pool *pool) 
+{
+  enum intr_level old_level;
+  size_t page_idx;
+  void **page;
+
+  if (pool->zeroed_cnt < ZEROED_LOW)
+    pool->refilling = true;
+  else if (pool->zeroed_cnt >= ZEROED_HIGH)
+    pool->refilling = false;
+  if (!pool->refilling || !lock_try_acquire (&pool->lock))
+    return false;
+  page_idx = bitmap_scan_and_flip_next (pool->used_map, 1, false);
+  lock_release (&pool->lock);
+  if (page_idx == BITMAP_ERROR) 
+    {
+      pool->refilling = false;
+      return false;
+    }
+
+  page = (void **) (pool->base + PGSIZE * page_idx);
+  memset (page, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  *page = pool->zeroed;
+  pool->zeroed = page;
+  pool->zeroed_cnt++;
+  intr_set_level (old_level);
+  return true;
 }
 
 /* Returns true if PAGE was allocated from POOL,
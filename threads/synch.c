@@ -270,10 +270,7 @@ lock_try_acquire(struct lock *lock)
   // Intenta bajar el semáforo asociado al candado
   bool success = sema_try_down(&lock->semaphore);
 
-  if (!success) {
-    // Si no se pudo adquirir el candado, intenta adquirirlo utilizando la función lock_acquire
-    lock_acquire(lock);
-  } else {
+  if (success) {
     // Si se adquirió el candado exitosamente, establece al hilo actual como su titular
     lock->holder = thread_current();
   }
@@ -462,6 +462,10 @@ idle (void *idle_started_ UNUSED)
 
   for (;;)
     {
+      /* Zero pages for palloc until another thread is ready. */
+      while (list_empty (&ready_list) && palloc_prezero ())
+        continue;
+
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
@@ -542,6 +546,15 @@ init_thread(struct thread *t, const char *name, int priority) {
   t->locker_thread = NULL;           // Inicializa el puntero al hilo que posee el candado que este hilo está esperando
   t->waiting_on_lock = NULL;         // Inicializa el puntero al candado que este hilo está esperando
 
+#ifdef USERPROG
+  t->exit_code = -1;
+  list_init (&t->children);
+#ifdef VM
+  list_init (&t->mappings);
+#endif
+  list_init (&t->fds);
+  t->next_handle = 2;
+#endif
 
   old_level = intr_disable();
   list_push_back(&all_list, &t->allelem);
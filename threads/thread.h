@@ -4,6 +4,10 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#ifdef VM
+#include <rhash.h>
+#include "vm/fault.h"
+#endif
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -80,7 +84,9 @@ typedef int tid_t;
    semaphore wait list (synch.c).  It can be used these two ways
    only because they are mutually exclusive: only a thread in the
    ready state is on the run queue, whereas only a thread in the
-   waiting_on_lock state is on a semaphore wait list. */
+   waiting_on_lock state is on a semaphore wait list.  A thread
+   blocked in timer_sleep() is on the timer's sleep list
+   (devices/timer.c) instead. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -93,7 +99,7 @@ struct thread
 
 
 
-  // Tiempo total que el hilo ha estado bloqueado
+  // Tick en el que timer_sleep() debe despertar al hilo
   int64_t sleepingtime;
 
   // Prioridad base del hilo
@@ -121,6 +127,27 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    struct file *bin_file;              /* Executable, denied writes. */
+    int exit_code;                      /* Exit code. */
+    struct wait_status *wait_status;    /* This process's completion state. */
+    struct list children;               /* Completion state of children. */
+
+    /* Owned by userprog/syscall.c. */
+    struct list fds;                    /* Open file descriptors. */
+    int next_handle;                    /* Next handle value. */
+#endif
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct rhash pages;                 /* Supplemental page table. */
+    void *user_esp;                     /* User stack pointer in syscalls. */
+    struct list mappings;               /* Memory-mapped files. */
+    struct fault_stats faults;          /* Page fault statistics. */
+    size_t resident_cnt;                /* Frames owned. */
+    size_t resident_target;             /* Frames allowed before eviction. */
+    int64_t last_fault;                 /* Ticks at last page-in fault. */
+    uint8_t *ra_next;                   /* Next page if faults are sequential. */
+    size_t ra_pages;                    /* Current read-ahead window. */
+    struct image *image;                /* Executable image. */
 #endif
 
     /* Owned by thread.c. */
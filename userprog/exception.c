@@ -4,6 +4,10 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -148,6 +152,26 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* Bring in the page, or make a private copy of it.  A fault in
+     the kernel happened during a system call, so the user stack
+     pointer is the one saved on entry to it. */
+  if (page_handle_fault (fault_addr, not_present, write,
+                         user ? f->esp : thread_current ()->user_esp))
+    return;
+#endif
+
+  /* A kernel access to a bad user address can only come from
+     get_user() or put_user() in userprog/syscall.c, which store
+     the address to resume at in %eax.  Make the access fail by
+     resuming there with %eax set to 0. */
+  if (!user && is_user_vaddr (fault_addr))
+    {
+      f->eip = (void (*) (void)) f->eax;
+      f->eax = 0;
+      return;
+    }
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
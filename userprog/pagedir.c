@@ -1,13 +1,25 @@
 #include "userprog/pagedir.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/init.h"
+#include "threads/loader.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
+/* Largest number of pages that pagedir_invalidate_range()
+   invalidates one by one.  Past this, reloading CR3 to flush the
+   whole TLB is cheaper than issuing one INVLPG per page. */
+#define INVLPG_MAX 32
+
+/* Number of times the whole TLB was flushed to invalidate a
+   range of pages. */
+static long long full_flush_cnt;
+
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static void invalidate_pagedir (uint32_t *, const void *);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -16,9 +28,16 @@ static void invalidate_pagedir (uint32_t *);
 uint32_t *
 pagedir_create (void) 
 {
-  uint32_t *pd = palloc_get_page (0);
+  uint32_t *pd = palloc_get_page (PAL_ZERO);
   if (pd != NULL)
-    memcpy (pd, init_page_dir, PGSIZE);
+    {
+      /* Only the kernel PDEs that map RAM are in use in
+         init_page_dir, so copy just those. */
+      size_t first = pd_no (PHYS_BASE);
+      size_t last = pd_no (ptov (init_ram_pages * PGSIZE - 1));
+      memcpy (pd + first, init_page_dir + first,
+              (last - first + 1) * sizeof *pd);
+    }
   return pd;
 }
 
@@ -152,7 +171,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_pagedir (pd, upage);
     }
 }
 
@@ -180,7 +199,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_pagedir (pd, vpage);
         }
     }
 }
@@ -209,11 +228,116 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_pagedir (pd, vpage);
         }
     }
 }
 
+/* Sets the writable bit to WRITABLE in the PTE for user virtual
+   page UPAGE in PD, which must be mapped. */
+void
+pagedir_set_writable (uint32_t *pd, const void *upage, bool writable) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  ASSERT (pte != NULL && (*pte & PTE_P) != 0);
+  if (writable)
+    *pte |= PTE_W;
+  else
+    *pte &= ~(uint32_t) PTE_W;
+  invalidate_pagedir (pd, upage);
+}
+
+/* Copies every user page mapped in page directory SRC into a
+   new page from the user pool, mapped at the same user virtual
+   address and with the same permissions in DST.  Returns true if
+   successful, false if memory allocation fails, in which case
+   DST may hold some of the copies; pagedir_destroy() frees
+   them. */
+bool
+pagedir_copy (uint32_t *dst, uint32_t *src) 
+{
+  uint32_t *pde;
+
+  for (pde = src; pde < src + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P) 
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        uint32_t *pte;
+
+        for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
+          if (*pte & PTE_P) 
+            {
+              void *upage = (void *) (((pde - src) << PDSHIFT)
+                                      | ((pte - pt) << PTSHIFT));
+              void *kpage = palloc_get_page (PAL_USER);
+
+              if (kpage == NULL)
+                return false;
+              memcpy (kpage, pte_get_page (*pte), PGSIZE);
+              if (!pagedir_set_page (dst, upage, kpage,
+                                     (*pte & PTE_W) != 0)) 
+                {
+                  palloc_free_page (kpage);
+                  return false;
+                }
+            }
+      }
+  return true;
+}
+
+/* Marks the N user virtual pages starting at UPAGE "not
+   present" in page directory PD, as pagedir_clear_page() would
+   for each one, but invalidates the TLB only once for the whole
+   range. */
+void
+pagedir_clear_range (uint32_t *pd, void *upage, size_t n) 
+{
+  uint8_t *page;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr ((uint8_t *) upage + n * PGSIZE - 1));
+
+  for (page = upage; page < (uint8_t *) upage + n * PGSIZE; page += PGSIZE)
+    {
+      uint32_t *pte = lookup_page (pd, page, false);
+      if (pte != NULL)
+        *pte &= ~PTE_P;
+    }
+  pagedir_invalidate_range (pd, upage, n);
+}
+
+/* Invalidates the TLB entries for the N pages starting at UPAGE
+   if PD is the active page directory.  Small ranges are
+   invalidated page by page; larger ones flush the whole TLB. */
+void
+pagedir_invalidate_range (uint32_t *pd, const void *upage, size_t n) 
+{
+  if (active_pd () != pd)
+    return;
+
+  if (n <= INVLPG_MAX) 
+    {
+      const uint8_t *page = pg_round_down (upage);
+      for (; n > 0; n--, page += PGSIZE)
+        asm volatile ("invlpg (%0)" : : "r" (page) : "memory");
+    }
+  else 
+    {
+      full_flush_cnt++;
+      pagedir_activate (pd);
+    }
+}
+
+/* Prints TLB statistics. */
+void
+pagedir_print_stats (void) 
+{
+  int64_t secs = timer_ticks () / TIMER_FREQ;
+  printf ("TLB: %lld full flushes (%lld per second)\n",
+          full_flush_cnt, secs > 0 ? full_flush_cnt / secs : full_flush_cnt);
+}
+
 /* Loads page directory PD into the CPU's page directory base
    register. */
 void
@@ -245,19 +369,18 @@ active_pd (void)
 
 /* Seom page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the TLB
+   entry for the page that changed.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   This function invalidates the TLB entry for VPAGE if PD is the
+   active page directory.  (If PD is not active then its entries
+   are not in the TLB, so there is no need to invalidate
+   anything.)  INVLPG drops just that one entry, unlike
+   re-activating PD, which would flush the whole TLB.  See
+   [IA32-v3a] 3.12 "Translation Lookaside Buffers (TLBs)". */
 static void
-invalidate_pagedir (uint32_t *pd) 
+invalidate_pagedir (uint32_t *pd, const void *vpage) 
 {
-  if (active_pd () == pd) 
-    {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
-    } 
+  if (active_pd () == pd)
+    asm volatile ("invlpg (%0)" : : "r" (vpage) : "memory");
 }
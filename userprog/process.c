@@ -7,6 +7,7 @@
 #include <string.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -15,42 +16,132 @@
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/fault.h"
+#include "vm/frame.h"
+#include "vm/image.h"
+#include "vm/page.h"
+#endif
+
+/* A command line broken into words by start_process().  The
+   words and the ARGV array that points to them both live in the
+   page that holds the command line, so that setup_stack() can
+   copy them onto the user stack in a single pass. */
+struct cmdline
+  {
+    int argc;                   /* Number of words. */
+    char **argv;                /* Words, followed by a null pointer. */
+    size_t size;                /* Bytes in all words, counting nulls. */
+  };
+
+/* Tracks the completion of a child process.  Referenced by both
+   the parent, in its `children' list, and the child, in its
+   `wait_status' pointer, so that the child's exit code outlives
+   the child's thread; freed when both have released it. */
+struct wait_status
+  {
+    struct list_elem elem;      /* Element in parent's `children'. */
+    struct lock lock;           /* Protects REF_CNT. */
+    int ref_cnt;                /* 2=child and parent both alive,
+                                   1=either child or parent alive,
+                                   0=child and parent both dead. */
+    tid_t tid;                  /* Child thread id. */
+    int exit_code;              /* Child exit code, if dead. */
+    struct semaphore dead;      /* 1=child alive, 0=child dead. */
+  };
+
+/* Pool of free wait_status records.  Records are carved out of
+   whole pages and recycled through this list, so allocating or
+   freeing one is a constant-time list operation. */
+static struct list free_statuses;
+static struct lock free_statuses_lock;
+
+/* Data shared between process_execute() in the invoking thread
+   and start_process() in the newly invoked thread. */
+struct exec_info
+  {
+    char *cmd_line;             /* Copy of the command line. */
+    struct semaphore load_done; /* "Up"ed when loading is complete. */
+    struct wait_status *wait_status; /* Child process. */
+    bool success;               /* Program successfully loaded? */
+  };
+
+/* Data shared between process_fork() in the parent and
+   start_fork() in the child. */
+struct fork_info
+  {
+    struct thread *parent;      /* Parent thread. */
+    const struct intr_frame *if_; /* Parent's user registers. */
+    struct semaphore fork_done; /* "Up"ed when the copy is complete. */
+    struct wait_status *wait_status; /* Child process. */
+    bool success;               /* Address space successfully copied? */
+  };
+
+static struct wait_status *wait_status_create (void);
+static void release_child (struct wait_status *);
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static thread_func start_fork NO_RETURN;
+static bool parse_cmdline (char *cmd_line, struct cmdline *);
+static bool load (const struct cmdline *, void (**eip) (void), void **esp);
+
+/* Initializes the process module. */
+void
+process_init (void) 
+{
+  list_init (&free_statuses);
+  lock_init (&free_statuses_lock);
+}
 
 /* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+   FILENAME, and waits for the program to be loaded.  Returns the
+   new process's thread id, or TID_ERROR if the thread cannot be
+   created or the program cannot be loaded. */
 tid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy;
+  struct exec_info exec;
+  char name[16];
   tid_t tid;
 
   /* Make a copy of FILE_NAME.
      Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+  exec.cmd_line = palloc_get_page (0);
+  if (exec.cmd_line == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+  strlcpy (exec.cmd_line, file_name, PGSIZE);
+  sema_init (&exec.load_done, 0);
+
+  /* Name the thread after the program, that is, the first word
+     of the command line. */
+  file_name += strspn (file_name, " ");
+  strlcpy (name, file_name, sizeof name);
+  name[strcspn (name, " ")] = '\0';
 
   /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
+  tid = thread_create (name, PRI_DEFAULT, start_process, &exec);
   if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
+    {
+      palloc_free_page (exec.cmd_line);
+      return TID_ERROR;
+    }
+  sema_down (&exec.load_done);
+  if (!exec.success)
+    return TID_ERROR;
+  list_push_back (&thread_current ()->children, &exec.wait_status->elem);
   return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *exec_)
 {
-  char *file_name = file_name_;
+  struct exec_info *exec = exec_;
+  struct cmdline cmd;
   struct intr_frame if_;
   bool success;
 
@@ -59,10 +150,29 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = parse_cmdline (exec->cmd_line, &cmd);
+  if (success)
+    {
+      lock_acquire (&filesys_lock);
+      success = load (&cmd, &if_.eip, &if_.esp);
+      lock_release (&filesys_lock);
+    }
+
+  /* Allocate wait_status. */
+  if (success)
+    {
+      exec->wait_status = thread_current ()->wait_status
+        = wait_status_create ();
+      success = exec->wait_status != NULL;
+    }
+
+  /* Notify the parent.  EXEC lives on the parent's stack, so it
+     must not be touched after this. */
+  palloc_free_page (exec->cmd_line);
+  exec->success = success;
+  sema_up (&exec->load_done);
 
   /* If load failed, quit. */
-  palloc_free_page (file_name);
   if (!success) 
     thread_exit ();
 
@@ -76,18 +186,151 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* Starts a new process that is a copy of the current one, whose
+   user registers at the time of the system call are in IF_, and
+   waits for the copy to complete.  The child returns 0 from the
+   system call.  Returns the child's thread id, or TID_ERROR if
+   the child cannot be created. */
+tid_t
+process_fork (const struct intr_frame *if_) 
+{
+  struct thread *cur = thread_current ();
+  struct fork_info fork;
+  tid_t tid;
+
+  fork.parent = cur;
+  fork.if_ = if_;
+  sema_init (&fork.fork_done, 0);
+
+  tid = thread_create (cur->name, cur->priority, start_fork, &fork);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+  sema_down (&fork.fork_done);
+  if (!fork.success)
+    return TID_ERROR;
+  list_push_back (&cur->children, &fork.wait_status->elem);
+  return tid;
+}
+
+/* A thread function that gives a forked process a copy of its
+   parent's address space and open files, then starts it running
+   where the parent made the fork system call.  The parent stays
+   blocked in process_fork() until the copy is complete. */
+static void
+start_fork (void *fork_)
+{
+  struct fork_info *fork = fork_;
+  struct thread *cur = thread_current ();
+  struct thread *parent = fork->parent;
+  struct intr_frame if_ = *fork->if_;
+  bool success = false;
+
+  if_.eax = 0;
+
+#ifdef VM
+  if (!page_table_init (&cur->pages))
+    goto done;
+#endif
+  cur->pagedir = pagedir_create ();
+  if (cur->pagedir == NULL)
+    goto done;
+  process_activate ();
+#ifdef VM
+  if (!page_table_copy (parent))
+    goto done;
+#else
+  if (!pagedir_copy (cur->pagedir, parent->pagedir))
+    goto done;
+#endif
+  if (!syscall_fork (parent))
+    goto done;
+
+  lock_acquire (&filesys_lock);
+  cur->bin_file = file_reopen (parent->bin_file);
+  if (cur->bin_file != NULL)
+    file_deny_write (cur->bin_file);
+  lock_release (&filesys_lock);
+  if (cur->bin_file == NULL)
+    goto done;
+#ifdef VM
+  page_rebind_file (parent->bin_file, cur->bin_file);
+  cur->image = image_ref (parent->image);
+#endif
+
+  fork->wait_status = cur->wait_status = wait_status_create ();
+  success = fork->wait_status != NULL;
+
+ done:
+  /* Notify the parent.  FORK lives on the parent's stack, so it
+     must not be touched after this. */
+  fork->success = success;
+  sema_up (&fork->fork_done);
+
+  if (!success)
+    thread_exit ();
+
+  /* Return to user mode as start_process() does. */
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Breaks CMD_LINE, which must start at the beginning of a page,
+   into words in place and describes them in *CMD.  The ARGV
+   array is stored in the same page, just past the end of the
+   command line, so no further memory is needed however many
+   words there are.  Returns false if the command line is empty
+   or if ARGV does not fit in the rest of the page, in which case
+   the arguments could not fit on the user stack either. */
+static bool
+parse_cmdline (char *cmd_line, struct cmdline *cmd)
+{
+  char *page_end = (char *) pg_round_down (cmd_line) + PGSIZE;
+  char *token, *save_ptr;
+
+  cmd->argc = 0;
+  cmd->size = 0;
+  cmd->argv = (char **) ROUND_UP ((uintptr_t) cmd_line + strlen (cmd_line) + 1,
+                                  sizeof (char *));
+  for (token = strtok_r (cmd_line, " ", &save_ptr); token != NULL;
+       token = strtok_r (NULL, " ", &save_ptr))
+    {
+      if ((char *) (cmd->argv + cmd->argc + 2) > page_end)
+        return false;
+      cmd->argv[cmd->argc++] = token;
+      cmd->size += strlen (token) + 1;
+    }
+  cmd->argv[cmd->argc] = NULL;
+  return cmd->argc > 0;
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   immediately, without waiting.  The waiting thread blocks on
+   the child's semaphore, which process_exit() in the child ups
+   directly. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
 {
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = list_next (e)) 
+    {
+      struct wait_status *cs = list_entry (e, struct wait_status, elem);
+      if (cs->tid == child_tid) 
+        {
+          int exit_code;
+          list_remove (e);
+          sema_down (&cs->dead);
+          exit_code = cs->exit_code;
+          release_child (cs);
+          return exit_code;
+        }
+    }
   return -1;
 }
 
@@ -98,6 +341,43 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+  /* Report how a user process ended. */
+  if (cur->pagedir != NULL)
+    {
+      printf ("%s: exit(%d)\n", cur->name, cur->exit_code);
+#ifdef VM
+      if (fault_stats_enabled)
+        fault_stats_print (&cur->faults, cur->name);
+#endif
+    }
+
+  /* Notify parent that we're dead. */
+  if (cur->wait_status != NULL) 
+    {
+      struct wait_status *cs = cur->wait_status;
+      cs->exit_code = cur->exit_code;
+      sema_up (&cs->dead);
+      release_child (cs);
+      cur->wait_status = NULL;
+    }
+
+  /* Free entries of children list. */
+  while (!list_empty (&cur->children))
+    release_child (list_entry (list_pop_front (&cur->children),
+                               struct wait_status, elem));
+
+  /* Close open files, including the executable, which may then be
+     written again. */
+  syscall_exit ();
+  if (cur->bin_file != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      file_allow_write (cur->bin_file);
+      file_close (cur->bin_file);
+      lock_release (&filesys_lock);
+      cur->bin_file = NULL;
+    }
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -112,10 +392,70 @@ process_exit (void)
          that's been freed (and cleared). */
       cur->pagedir = NULL;
       pagedir_activate (NULL);
+#ifdef VM
+      page_table_destroy (&cur->pages, pd);
+      image_release (cur->image);
+      cur->image = NULL;
+#endif
       pagedir_destroy (pd);
     }
 }
 
+/* Returns a new wait_status for the current process, taken from
+   the pool of free records, or a null pointer if memory
+   allocation fails.  The caller and the parent each hold one
+   reference to it. */
+static struct wait_status *
+wait_status_create (void) 
+{
+  struct wait_status *cs = NULL;
+
+  lock_acquire (&free_statuses_lock);
+  if (list_empty (&free_statuses)) 
+    {
+      /* Refill the pool with a fresh page's worth of records. */
+      struct wait_status *page = palloc_get_page (0);
+      size_t i;
+
+      if (page != NULL)
+        for (i = 0; i < PGSIZE / sizeof *page; i++)
+          list_push_back (&free_statuses, &page[i].elem);
+    }
+  if (!list_empty (&free_statuses))
+    cs = list_entry (list_pop_front (&free_statuses),
+                     struct wait_status, elem);
+  lock_release (&free_statuses_lock);
+
+  if (cs != NULL) 
+    {
+      lock_init (&cs->lock);
+      cs->ref_cnt = 2;
+      cs->tid = thread_current ()->tid;
+      cs->exit_code = -1;
+      sema_init (&cs->dead, 0);
+    }
+  return cs;
+}
+
+/* Releases one reference to CS and, if it is now unreferenced,
+   returns it to the pool. */
+static void
+release_child (struct wait_status *cs) 
+{
+  int new_ref_cnt;
+  
+  lock_acquire (&cs->lock);
+  new_ref_cnt = --cs->ref_cnt;
+  lock_release (&cs->lock);
+
+  if (new_ref_cnt == 0) 
+    {
+      lock_acquire (&free_statuses_lock);
+      list_push_front (&free_statuses, &cs->elem);
+      lock_release (&free_statuses_lock);
+    }
+}
+
 /* Sets up the CPU for running user code in the current
    thread.
    This function is called on every context switch. */
@@ -195,26 +535,39 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp);
+static bool setup_stack (const struct cmdline *, void **esp);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
+#ifndef VM
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
+#endif
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
-   Stores the executable's entry point into *EIP
+/* Loads the ELF executable named by the first word of CMD into
+   the current thread and passes it the words of CMD as its
+   arguments.  Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
-bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+static bool
+load (const struct cmdline *cmd, void (**eip) (void), void **esp) 
 {
+  const char *file_name = cmd->argv[0];
   struct thread *t = thread_current ();
   struct Elf32_Ehdr ehdr;
   struct file *file = NULL;
+#ifdef VM
+  struct image *image = NULL;
+#endif
   off_t file_ofs;
   bool success = false;
   int i;
 
+#ifdef VM
+  /* Allocate supplemental page table. */
+  if (!page_table_init (&t->pages))
+    return false;
+#endif
+
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
@@ -229,6 +582,17 @@ load (const char *file_name, void (**eip) (void), void **esp)
       goto done; 
     }
 
+#ifdef VM
+  /* If the executable has been run recently, its headers have
+     already been parsed and its read-only pages are in memory. */
+  image = image_lookup (file_get_inode (file));
+  if (image != NULL)
+    goto map_image;
+  image = image_create (file_get_inode (file));
+  if (image == NULL)
+    goto done;
+#endif
+
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
@@ -291,9 +655,15 @@ load (const char *file_name, void (**eip) (void), void **esp)
                   read_bytes = 0;
                   zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
                 }
+#ifdef VM
+              if (!image_add_segment (image, file_page, (void *) mem_page,
+                                      read_bytes, zero_bytes, writable))
+                goto done;
+#else
               if (!load_segment (file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
                 goto done;
+#endif
             }
           else
             goto done;
@@ -301,24 +671,50 @@ load (const char *file_name, void (**eip) (void), void **esp)
         }
     }
 
-  /* Set up stack. */
-  if (!setup_stack (esp))
-    goto done;
+#ifdef VM
+  image->entry = (void (*) (void)) ehdr.e_entry;
+  image_insert (image);
 
+ map_image:
+  /* Map the executable's segments. */
+  if (!image_map (image, file))
+    goto done;
+  *eip = image->entry;
+#else
   /* Start address. */
   *eip = (void (*) (void)) ehdr.e_entry;
+#endif
 
+  /* Set up stack. */
+  if (!setup_stack (cmd, esp))
+    goto done;
+
+  /* Keep the executable open, and unmodifiable, while it runs.
+     Its pages are read from it on demand. */
+  file_deny_write (file);
+  t->bin_file = file;
+#ifdef VM
+  t->image = image;
+  image = NULL;
+#endif
   success = true;
 
  done:
   /* We arrive here whether the load is successful or not. */
-  file_close (file);
+#ifdef VM
+  image_release (image);
+#endif
+  if (!success)
+    file_close (file);
   return success;
 }
 
 /* load() helpers. */
 
+static uint8_t *map_zeroed_page (void *upage);
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -365,6 +761,7 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
   return true;
 }
 
+#ifndef VM
 /* Loads a segment starting at offset OFS in FILE at address
    UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual
    memory are initialized, as follows:
@@ -423,27 +820,83 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
     }
   return true;
 }
+#endif /* !VM */
 
 /* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+   user virtual memory, and push the words in CMD onto it
+   following the 80x86 calling convention: the words themselves,
+   padding to a word boundary, argv[] with its null sentinel,
+   argv, argc, and a fake return address.  The page is filled in
+   through its kernel address, so each word is copied exactly
+   once.  Fails if the arguments do not fit in the page. */
 static bool
-setup_stack (void **esp) 
+setup_stack (const struct cmdline *cmd, void **esp) 
 {
-  uint8_t *kpage;
-  bool success = false;
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+  uint8_t *kpage, *word;
+  size_t frame_size;
+  uint32_t *frame;
+  char **argv;
+  int i;
+
+  frame_size = (ROUND_UP (cmd->size, sizeof (char *))
+                + (cmd->argc + 1) * sizeof (char *)
+                + sizeof (char **) + sizeof (int) + sizeof (void *));
+  if (frame_size > PGSIZE)
+    return false;
+
+  kpage = map_zeroed_page (upage);
+  if (kpage == NULL)
+    return false;
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL) 
+  frame = (uint32_t *) (kpage + PGSIZE - frame_size);
+  argv = (char **) (frame + 3);
+  word = kpage + PGSIZE;
+  for (i = 0; i < cmd->argc; i++)
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-      if (success)
-        *esp = PHYS_BASE;
-      else
-        palloc_free_page (kpage);
+      size_t len = strlen (cmd->argv[i]) + 1;
+
+      word -= len;
+      memcpy (word, cmd->argv[i], len);
+      argv[i] = (char *) upage + (word - kpage);
     }
-  return success;
+  argv[cmd->argc] = NULL;
+
+  frame[0] = 0;
+  frame[1] = cmd->argc;
+  frame[2] = (uint32_t) (upage + ((uint8_t *) argv - kpage));
+  *esp = upage + ((uint8_t *) frame - kpage);
+  return true;
+}
+
+/* Maps a zeroed page at user virtual address UPAGE, writable by
+   the user process, and returns its kernel virtual address.
+   Returns a null pointer if memory allocation fails. */
+static uint8_t *
+map_zeroed_page (void *upage) 
+{
+#ifdef VM
+  struct frame *frame = frame_alloc (PAL_ZERO);
+  if (frame == NULL)
+    return NULL;
+  if (!page_install (upage, frame, true)) 
+    {
+      frame_unref (frame);
+      return NULL;
+    }
+  return frame->kpage;
+#else
+  uint8_t *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (kpage != NULL && !install_page (upage, kpage, true)) 
+    {
+      palloc_free_page (kpage);
+      return NULL;
+    }
+  return kpage;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -463,3 +916,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif /* !VM */
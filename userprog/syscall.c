@@ -1,20 +1,725 @@
 #include "userprog/syscall.h"
+#include <list.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* A file descriptor, which binds a handle to an open file. */
+struct file_descriptor
+  {
+    struct list_elem elem;      /* Element in thread's `fds' list. */
+    struct file *file;          /* Open file. */
+    int handle;                 /* File handle. */
+  };
+
+#ifdef VM
+/* A memory mapping, which binds a mapping id to the pages that
+   map a file. */
+struct mapping
+  {
+    struct list_elem elem;      /* Element in thread's `mappings' list. */
+    int handle;                 /* Mapping id. */
+    struct file *file;          /* Mapped file, reopened for the mapping. */
+    uint8_t *base;              /* Start of the mapping. */
+    size_t page_cnt;            /* Number of pages mapped. */
+  };
+#endif
+
+/* Number of arguments taken by each system call. */
+static const int arg_cnts[] =
+  {
+    [SYS_HALT] = 0, [SYS_EXIT] = 1, [SYS_EXEC] = 1, [SYS_WAIT] = 1,
+    [SYS_CREATE] = 2, [SYS_REMOVE] = 1, [SYS_OPEN] = 1,
+    [SYS_FILESIZE] = 1, [SYS_READ] = 3, [SYS_WRITE] = 3,
+    [SYS_SEEK] = 2, [SYS_TELL] = 1, [SYS_CLOSE] = 1,
+    [SYS_MMAP] = 2, [SYS_MUNMAP] = 1, [SYS_FORK] = 0,
+  };
 
 static void syscall_handler (struct intr_frame *);
 
+static void sys_halt (void) NO_RETURN;
+static void sys_exit (int status) NO_RETURN;
+static int sys_exec (const char *ufile);
+static int sys_wait (tid_t);
+static int sys_create (const char *ufile, unsigned initial_size);
+static int sys_remove (const char *ufile);
+static int sys_open (const char *ufile);
+static int sys_filesize (int handle);
+static int sys_read (int handle, void *udst, unsigned size);
+static int sys_write (int handle, const void *usrc, unsigned size);
+static int sys_seek (int handle, unsigned position);
+static int sys_tell (int handle);
+static int sys_close (int handle);
+static int sys_fork (struct intr_frame *);
+#ifdef VM
+static int sys_mmap (int handle, void *addr);
+static int sys_munmap (int mapping);
+static void unmap (struct mapping *);
+#endif
+
+static void copy_in (void *, const void *, size_t);
+static void copy_out (void *, const void *, size_t);
+static char *copy_in_string (const char *);
+static struct file_descriptor *lookup_fd (int handle);
+
 void
-syscall_init (void) 
+syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
+/* System call handler.  The system call number is at the user
+   stack pointer, followed by its arguments. */
+static void
+syscall_handler (struct intr_frame *f)
+{
+  uint32_t args[3];
+  unsigned number;
+
+#ifdef VM
+  /* Page faults in system calls need the user stack pointer to
+     tell stack accesses from bad ones. */
+  thread_current ()->user_esp = f->esp;
+#endif
+
+  copy_in (&number, f->esp, sizeof number);
+  if (number >= sizeof arg_cnts / sizeof *arg_cnts)
+    thread_exit ();
+  copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * arg_cnts[number]);
+
+  switch (number)
+    {
+    case SYS_HALT:
+      sys_halt ();
+    case SYS_EXIT:
+      sys_exit (args[0]);
+    case SYS_EXEC:
+      f->eax = sys_exec ((const char *) args[0]);
+      break;
+    case SYS_WAIT:
+      f->eax = sys_wait (args[0]);
+      break;
+    case SYS_CREATE:
+      f->eax = sys_create ((const char *) args[0], args[1]);
+      break;
+    case SYS_REMOVE:
+      f->eax = sys_remove ((const char *) args[0]);
+      break;
+    case SYS_OPEN:
+      f->eax = sys_open ((const char *) args[0]);
+      break;
+    case SYS_FILESIZE:
+      f->eax = sys_filesize (args[0]);
+      break;
+    case SYS_READ:
+      f->eax = sys_read (args[0], (void *) args[1], args[2]);
+      break;
+    case SYS_WRITE:
+      f->eax = sys_write (args[0], (const void *) args[1], args[2]);
+      break;
+    case SYS_SEEK:
+      f->eax = sys_seek (args[0], args[1]);
+      break;
+    case SYS_TELL:
+      f->eax = sys_tell (args[0]);
+      break;
+    case SYS_CLOSE:
+      f->eax = sys_close (args[0]);
+      break;
+#ifdef VM
+    case SYS_MMAP:
+      f->eax = sys_mmap (args[0], (void *) args[1]);
+      break;
+    case SYS_MUNMAP:
+      f->eax = sys_munmap (args[0]);
+      break;
+#endif
+    case SYS_FORK:
+      f->eax = sys_fork (f);
+      break;
+    default:
+      thread_exit ();
+    }
+}
+
+/* Unmaps every memory mapping and closes every file that the
+   current process has open.  Called by process_exit(). */
+void
+syscall_exit (void)
+{
+  struct thread *cur = thread_current ();
+
+#ifdef VM
+  while (!list_empty (&cur->mappings))
+    unmap (list_entry (list_front (&cur->mappings), struct mapping, elem));
+#endif
+
+  while (!list_empty (&cur->fds))
+    {
+      struct file_descriptor *fd;
+
+      fd = list_entry (list_pop_front (&cur->fds),
+                       struct file_descriptor, elem);
+      lock_acquire (&filesys_lock);
+      file_close (fd->file);
+      lock_release (&filesys_lock);
+      free (fd);
+    }
+}
+
+/* Gives the current process, a child being forked from PARENT,
+   its own copy of each of PARENT's file descriptors, with the
+   same handle and file position.  Returns true if successful,
+   false if memory allocation fails. */
+bool
+syscall_fork (struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+  bool success = true;
+
+  lock_acquire (&filesys_lock);
+  for (e = list_begin (&parent->fds); e != list_end (&parent->fds);
+       e = list_next (e))
+    {
+      struct file_descriptor *pfd, *fd;
+
+      pfd = list_entry (e, struct file_descriptor, elem);
+      fd = malloc (sizeof *fd);
+      if (fd == NULL)
+        {
+          success = false;
+          break;
+        }
+      fd->file = file_reopen (pfd->file);
+      if (fd->file == NULL)
+        {
+          free (fd);
+          success = false;
+          break;
+        }
+      file_seek (fd->file, file_tell (pfd->file));
+      fd->handle = pfd->handle;
+      list_push_back (&cur->fds, &fd->elem);
+    }
+#ifdef VM
+  for (e = list_begin (&parent->mappings);
+       success && e != list_end (&parent->mappings); e = list_next (e))
+    {
+      struct mapping *pm, *m;
+      size_t i;
+
+      pm = list_entry (e, struct mapping, elem);
+      m = malloc (sizeof *m);
+      if (m == NULL)
+        {
+          success = false;
+          break;
+        }
+      *m = *pm;
+      m->file = file_reopen (pm->file);
+      if (m->file == NULL)
+        {
+          free (m);
+          success = false;
+          break;
+        }
+      list_push_back (&cur->mappings, &m->elem);
+
+      /* page_table_copy() left the child's pages pointing to the
+         parent's file. */
+      for (i = 0; i < m->page_cnt; i++)
+        page_lookup (m->base + i * PGSIZE)->file = m->file;
+    }
+#endif
+  lock_release (&filesys_lock);
+  cur->next_handle = parent->next_handle;
+
+  return success;
+}
+
+/* Halt system call. */
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+sys_halt (void)
 {
-  printf ("system call!\n");
+  shutdown_power_off ();
+}
+
+/* Exit system call. */
+static void
+sys_exit (int status)
+{
+  thread_current ()->exit_code = status;
   thread_exit ();
 }
+
+/* Exec system call. */
+static int
+sys_exec (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  tid_t tid = process_execute (kfile);
+
+  palloc_free_page (kfile);
+  return tid;
+}
+
+/* Wait system call. */
+static int
+sys_wait (tid_t child)
+{
+  return process_wait (child);
+}
+
+/* Create system call. */
+static int
+sys_create (const char *ufile, unsigned initial_size)
+{
+  char *kfile = copy_in_string (ufile);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_create (kfile, initial_size);
+  lock_release (&filesys_lock);
+
+  palloc_free_page (kfile);
+  return ok;
+}
+
+/* Remove system call. */
+static int
+sys_remove (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_remove (kfile);
+  lock_release (&filesys_lock);
+
+  palloc_free_page (kfile);
+  return ok;
+}
+
+/* Open system call. */
+static int
+sys_open (const char *ufile)
+{
+  struct thread *cur = thread_current ();
+  char *kfile = copy_in_string (ufile);
+  struct file_descriptor *fd;
+  int handle = -1;
+
+  fd = malloc (sizeof *fd);
+  if (fd != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      fd->file = filesys_open (kfile);
+      lock_release (&filesys_lock);
+      if (fd->file != NULL)
+        {
+          handle = fd->handle = cur->next_handle++;
+          list_push_front (&cur->fds, &fd->elem);
+        }
+      else
+        free (fd);
+    }
+
+  palloc_free_page (kfile);
+  return handle;
+}
+
+/* Filesize system call. */
+static int
+sys_filesize (int handle)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+  int size;
+
+  lock_acquire (&filesys_lock);
+  size = file_length (fd->file);
+  lock_release (&filesys_lock);
+
+  return size;
+}
+
+/* Read system call.  File data passes through a kernel buffer so
+   that the file system lock is never held while touching user
+   memory, which might fault. */
+static int
+sys_read (int handle, void *udst_, unsigned size)
+{
+  uint8_t *udst = udst_;
+  struct file_descriptor *fd;
+  uint8_t *buffer;
+  int bytes_read = 0;
+
+  if (handle == STDIN_FILENO)
+    {
+      for (; size > 0; size--, udst++, bytes_read++)
+        {
+          uint8_t c = input_getc ();
+          copy_out (udst, &c, 1);
+        }
+      return bytes_read;
+    }
+
+  fd = lookup_fd (handle);
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    thread_exit ();
+  while (size > 0)
+    {
+      size_t chunk = size < PGSIZE ? size : PGSIZE;
+      off_t retval;
+
+      lock_acquire (&filesys_lock);
+      retval = file_read (fd->file, buffer, chunk);
+      lock_release (&filesys_lock);
+
+      if (retval <= 0)
+        break;
+      copy_out (udst, buffer, retval);
+      bytes_read += retval;
+      if (retval != (off_t) chunk)
+        break;
+
+      udst += chunk;
+      size -= chunk;
+    }
+  palloc_free_page (buffer);
+
+  return bytes_read;
+}
+
+/* Write system call.  See sys_read() for why data passes through
+   a kernel buffer. */
+static int
+sys_write (int handle, const void *usrc_, unsigned size)
+{
+  const uint8_t *usrc = usrc_;
+  struct file_descriptor *fd = NULL;
+  uint8_t *buffer;
+  int bytes_written = 0;
+
+  if (handle != STDOUT_FILENO)
+    fd = lookup_fd (handle);
+
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    thread_exit ();
+  while (size > 0)
+    {
+      size_t chunk = size < PGSIZE ? size : PGSIZE;
+      off_t retval;
+
+      copy_in (buffer, usrc, chunk);
+      if (fd == NULL)
+        {
+          putbuf ((const char *) buffer, chunk);
+          retval = chunk;
+        }
+      else
+        {
+          lock_acquire (&filesys_lock);
+          retval = file_write (fd->file, buffer, chunk);
+          lock_release (&filesys_lock);
+        }
+
+      if (retval <= 0)
+        break;
+      bytes_written += retval;
+      if (retval != (off_t) chunk)
+        break;
+
+      usrc += chunk;
+      size -= chunk;
+    }
+  palloc_free_page (buffer);
+
+  return bytes_written;
+}
+
+/* Seek system call. */
+static int
+sys_seek (int handle, unsigned position)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+
+  lock_acquire (&filesys_lock);
+  if ((off_t) position >= 0)
+    file_seek (fd->file, position);
+  lock_release (&filesys_lock);
+
+  return 0;
+}
+
+/* Tell system call. */
+static int
+sys_tell (int handle)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+  unsigned position;
+
+  lock_acquire (&filesys_lock);
+  position = file_tell (fd->file);
+  lock_release (&filesys_lock);
+
+  return position;
+}
+
+/* Close system call. */
+static int
+sys_close (int handle)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+
+  lock_acquire (&filesys_lock);
+  file_close (fd->file);
+  lock_release (&filesys_lock);
+  list_remove (&fd->elem);
+  free (fd);
+
+  return 0;
+}
+
+/* Fork system call.  The child resumes from the same system call
+   with F's registers, but with a return value of 0. */
+static int
+sys_fork (struct intr_frame *f)
+{
+  return process_fork (f);
+}
+
+#ifdef VM
+/* Mmap system call.  Pages are only recorded here; each one is
+   read from the file when first accessed. */
+static int
+sys_mmap (int handle, void *addr_)
+{
+  struct thread *cur = thread_current ();
+  struct file_descriptor *fd = lookup_fd (handle);
+  uint8_t *addr = addr_;
+  struct mapping *m;
+  off_t length;
+  size_t i;
+
+  if (addr == NULL || pg_ofs (addr) != 0 || !is_user_vaddr (addr))
+    return -1;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return -1;
+  lock_acquire (&filesys_lock);
+  m->file = file_reopen (fd->file);
+  length = m->file != NULL ? file_length (m->file) : 0;
+  lock_release (&filesys_lock);
+  if (length <= 0 || (size_t) length > (size_t) ((uint8_t *) PHYS_BASE - addr))
+    {
+      lock_acquire (&filesys_lock);
+      file_close (m->file);
+      lock_release (&filesys_lock);
+      free (m);
+      return -1;
+    }
+
+  m->handle = cur->next_handle++;
+  m->base = addr;
+  m->page_cnt = 0;
+  list_push_front (&cur->mappings, &m->elem);
+
+  for (i = 0; i * PGSIZE < (size_t) length; i++)
+    {
+      size_t bytes = length - i * PGSIZE;
+      if (bytes > PGSIZE)
+        bytes = PGSIZE;
+      if (!page_map_file (addr + i * PGSIZE, m->file, i * PGSIZE, bytes))
+        {
+          unmap (m);
+          return -1;
+        }
+      m->page_cnt++;
+    }
+  return m->handle;
+}
+
+/* Munmap system call. */
+static int
+sys_munmap (int mapping)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->handle == mapping)
+        {
+          unmap (m);
+          return 0;
+        }
+    }
+  thread_exit ();
+}
+
+/* Removes mapping M from the current process, writing its dirty
+   pages back to the file, and frees it. */
+static void
+unmap (struct mapping *m)
+{
+  page_unmap (m->base, m->page_cnt);
+
+  list_remove (&m->elem);
+  lock_acquire (&filesys_lock);
+  file_close (m->file);
+  lock_release (&filesys_lock);
+  free (m);
+}
+#endif
+
+/* Returns the file descriptor associated with the given HANDLE.
+   Terminates the process if HANDLE is not associated with an
+   open file. */
+static struct file_descriptor *
+lookup_fd (int handle)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->fds); e != list_end (&cur->fds);
+       e = list_next (e))
+    {
+      struct file_descriptor *fd;
+      fd = list_entry (e, struct file_descriptor, elem);
+      if (fd->handle == handle)
+        return fd;
+    }
+
+  thread_exit ();
+}
+
+/* Copies a byte from user address USRC to kernel address DST.
+   USRC must be below PHYS_BASE.
+   Returns true if successful, false if a segfault occurred. */
+static inline bool
+get_user (uint8_t *dst, const uint8_t *usrc)
+{
+  int eax;
+  asm ("movl $1f, %%eax; movb %2, %%al; movb %%al, %0; 1:"
+       : "=m" (*dst), "=&a" (eax) : "m" (*usrc));
+  return eax != 0;
+}
+
+/* Writes BYTE to user address UDST.
+   UDST must be below PHYS_BASE.
+   Returns true if successful, false if a segfault occurred. */
+static inline bool
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int eax;
+  asm ("movl $1f, %%eax; movb %b2, %0; 1:"
+       : "=m" (*udst), "=&a" (eax) : "q" (byte));
+  return eax != 0;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Terminates the process if any of the bytes is not in
+   valid user memory.
+
+   Each user page is first touched with get_user(), which makes
+   the page present or reports that it is invalid, and is then
+   copied in one piece.  A page that is evicted in between is
+   simply faulted back in by the copy. */
+static void
+copy_in (void *dst_, const void *usrc_, size_t size)
+{
+  uint8_t *dst = dst_;
+  const uint8_t *usrc = usrc_;
+
+  while (size > 0)
+    {
+      size_t chunk = PGSIZE - pg_ofs (usrc);
+      if (chunk > size)
+        chunk = size;
+
+      if (!is_user_vaddr (usrc) || !get_user (dst, usrc))
+        thread_exit ();
+      memcpy (dst, usrc, chunk);
+
+      dst += chunk;
+      usrc += chunk;
+      size -= chunk;
+    }
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Terminates the process if any of the bytes is not in
+   writable user memory.  See copy_in() for how user pages are
+   accessed. */
+static void
+copy_out (void *udst_, const void *src_, size_t size)
+{
+  uint8_t *udst = udst_;
+  const uint8_t *src = src_;
+
+  while (size > 0)
+    {
+      size_t chunk = PGSIZE - pg_ofs (udst);
+      uint8_t byte;
+      if (chunk > size)
+        chunk = size;
+
+      if (!is_user_vaddr (udst)
+          || !get_user (&byte, udst) || !put_user (udst, byte))
+        thread_exit ();
+      memcpy (udst, src, chunk);
+
+      udst += chunk;
+      src += chunk;
+      size -= chunk;
+    }
+}
+
+/* Creates a copy of user string US in kernel memory and returns
+   it as a page that must be freed with palloc_free_page().
+   Truncates the string at PGSIZE bytes in size.  Terminates the
+   process if any part of the string is not in valid user
+   memory. */
+static char *
+copy_in_string (const char *us)
+{
+  char *ks;
+  size_t length;
+
+  ks = palloc_get_page (0);
+  if (ks == NULL)
+    thread_exit ();
+
+  for (length = 0; length < PGSIZE; length++)
+    {
+      if (!is_user_vaddr (us + length)
+          || !get_user ((uint8_t *) ks + length, (const uint8_t *) us + length))
+        {
+          palloc_free_page (ks);
+          thread_exit ();
+        }
+      if (ks[length] == '\0')
+        return ks;
+    }
+  ks[PGSIZE - 1] = '\0';
+  return ks;
+}
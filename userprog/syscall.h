@@ -1,6 +1,12 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+
+struct thread;
+
 void syscall_init (void);
+void syscall_exit (void);
+bool syscall_fork (struct thread *parent);
 
 #endif /* userprog/syscall.h */
@@ -0,0 +1,69 @@
+#include "vm/fault.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/cycles.h"
+
+/* Page fault statistics.
+
+   Each process counts the faults it takes by type, keeps a
+   histogram of how long each took to service, in CPU cycles read
+   with RDTSC and bucketed by their base-2 logarithm, and keeps
+   the addresses of its most recent faults in a ring buffer.
+   With the -fstats kernel command-line option, all of this is
+   printed when the process exits. */
+
+bool fault_stats_enabled;
+
+/* Names of fault types, for printing. */
+static const char *type_names[FAULT_TYPE_CNT] =
+  {
+    [FAULT_MINOR] = "minor", [FAULT_MAJOR] = "major",
+    [FAULT_COW] = "cow", [FAULT_STACK] = "stack",
+    [FAULT_REFAULT] = "refault",
+  };
+
+/* Records in STATS a fault of the given TYPE at FAULT_ADDR,
+   whose handling began when rdtsc() returned START.  If
+   REFAULT is true, the fault brought back an evicted page and is
+   counted as a FAULT_REFAULT too. */
+void
+fault_stats_record (struct fault_stats *stats, enum fault_type type,
+                    bool refault, const void *fault_addr, uint64_t start) 
+{
+  uint64_t cycles = rdtsc () - start;
+  int bucket = 0;
+
+  while (bucket < FAULT_HIST_BUCKETS - 1 && cycles >> (bucket + 1) != 0)
+    bucket++;
+
+  ASSERT (type != FAULT_REFAULT);
+  stats->cnt[type]++;
+  if (refault)
+    stats->cnt[FAULT_REFAULT]++;
+  stats->hist[bucket]++;
+  stats->trace[stats->trace_cnt++ % FAULT_TRACE_LEN] = (void *) fault_addr;
+}
+
+/* Prints STATS for the process named NAME. */
+void
+fault_stats_print (const struct fault_stats *stats, const char *name) 
+{
+  unsigned i, n;
+
+  printf ("%s: faults:", name);
+  for (i = 0; i < FAULT_TYPE_CNT; i++)
+    printf (" %u %s", stats->cnt[i], type_names[i]);
+  printf ("\n");
+
+  printf ("%s: fault cycles:", name);
+  for (i = 0; i < FAULT_HIST_BUCKETS; i++)
+    if (stats->hist[i] != 0)
+      printf (" 2^%u:%u", i, stats->hist[i]);
+  printf ("\n");
+
+  printf ("%s: fault trace:", name);
+  n = stats->trace_cnt < FAULT_TRACE_LEN ? stats->trace_cnt : FAULT_TRACE_LEN;
+  for (i = stats->trace_cnt - n; i < stats->trace_cnt; i++)
+    printf (" %p", stats->trace[i % FAULT_TRACE_LEN]);
+  printf ("\n");
+}
@@ -0,0 +1,48 @@
+#ifndef VM_FAULT_H
+#define VM_FAULT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kinds of page faults resolved by page_handle_fault().  Each
+   fault has one of the types up to FAULT_STACK.  A fault that
+   brings back a page that was evicted is also counted as a
+   FAULT_REFAULT, whether the page came from swap (a major
+   fault) or was dropped and read again from its file (major or,
+   through the executable image cache, minor). */
+enum fault_type
+  {
+    FAULT_MINOR,                /* Page resident or zero, no I/O. */
+    FAULT_MAJOR,                /* Page read from a file or swap. */
+    FAULT_COW,                  /* Private copy of a shared page. */
+    FAULT_STACK,                /* Stack growth. */
+    FAULT_REFAULT,              /* Also: page brought back after eviction. */
+    FAULT_TYPE_CNT
+  };
+
+/* Number of buckets in the fault service time histogram.  Bucket
+   I counts faults that took 2**I to 2**(I+1) - 1 CPU cycles, and
+   the last bucket also counts all slower ones. */
+#define FAULT_HIST_BUCKETS 24
+
+/* Number of fault addresses kept in the trace buffer. */
+#define FAULT_TRACE_LEN 16
+
+/* Per-process page fault statistics. */
+struct fault_stats
+  {
+    unsigned cnt[FAULT_TYPE_CNT];       /* Faults of each type. */
+    unsigned hist[FAULT_HIST_BUCKETS];  /* Service time, log2 cycles. */
+    void *trace[FAULT_TRACE_LEN];       /* Most recent fault addresses. */
+    unsigned trace_cnt;                 /* Faults ever traced. */
+  };
+
+/* Print each process's fault statistics when it exits? */
+extern bool fault_stats_enabled;
+
+void fault_stats_record (struct fault_stats *, enum fault_type,
+                         bool refault, const void *fault_addr,
+                         uint64_t start);
+void fault_stats_print (const struct fault_stats *, const char *name);
+
+#endif /* vm/fault.h */
@@ -0,0 +1,459 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+
+/* Frame table.
+
+   There is one entry for every page in the user pool, kept in an
+   array indexed by the page's position in the pool, so finding
+   the frame for a kernel virtual address takes constant time.
+   Frames themselves are still obtained from and returned to the
+   page allocator; the table only adds bookkeeping.
+
+   When the user pool is empty, a frame is taken away from the
+   page that owns it, chosen by sweeping a clock hand over the
+   table.  The default WSClock policy treats a frame as part of
+   its process's working set if it was accessed within the last
+   WS_WINDOW ticks, and first looks for clean frames that are
+   outside their working set or belong to a process holding more
+   frames than its target, which page_handle_fault() adjusts from
+   the process's page fault frequency.  Failing that, it accepts
+   dirty frames, and finally any frame not recently accessed.
+   The plain clock policy only looks at accessed bits.
+
+   Frames held only by the executable image cache hold clean
+   program text that no process is using, so the hand takes them
+   as soon as they have been idle for WS_WINDOW ticks, and on
+   any later pass.  A cached frame that one process maps is
+   evicted like a frame of that process alone, and leaves the
+   cache with it. */
+static struct frame *frames;    /* Array of frames. */
+static size_t frame_cnt;        /* Number of elements in FRAMES. */
+static uint8_t *user_base;      /* Kernel address of first frame. */
+static size_t hand;             /* Clock hand, an index into FRAMES. */
+
+/* A frame of zeros, shared read-only by every page that has been
+   read but never written.  The table holds a reference to it, so
+   it is never freed, and since it is always shared it is never
+   evicted either. */
+static struct frame *zero_frame;
+
+/* Working set window, in timer ticks. */
+#define WS_WINDOW (TIMER_FREQ / 2)
+
+enum frame_policy frame_policy = FRAME_WSCLOCK;
+
+/* Protects reference counts, owners, and the clock hand. */
+static struct lock frame_lock;
+
+static struct frame *claim_frame (void *kpage);
+static void update_owner (struct frame *);
+static struct frame *evict_frame (void);
+
+/* Initializes the frame table. */
+void
+frame_init (void) 
+{
+  size_t i;
+
+  lock_init (&frame_lock);
+  frame_cnt = palloc_user_range (&user_base);
+  frames = calloc (frame_cnt, sizeof *frames);
+  if (frames == NULL)
+    PANIC ("frame_init: out of memory for %zu frames", frame_cnt);
+  for (i = 0; i < frame_cnt; i++) 
+    {
+      frames[i].kpage = user_base + i * PGSIZE;
+      list_init (&frames[i].pages);
+    }
+  zero_frame = claim_frame (palloc_get_page (PAL_USER | PAL_ZERO
+                                             | PAL_ASSERT));
+}
+
+/* Obtains a free frame from the user pool, evicting a page if
+   there is none, and returns it with a reference count of 1.
+   Returns a null pointer if no frame can be freed.  If PAL_ZERO
+   is set in FLAGS, the frame is filled with zeros. */
+struct frame *
+frame_alloc (enum palloc_flags flags) 
+{
+  void *kpage = palloc_get_page (PAL_USER | flags);
+  struct frame *f;
+
+  if (kpage == NULL)
+    {
+      f = evict_frame ();
+      if (f != NULL && (flags & PAL_ZERO))
+        memset (f->kpage, 0, PGSIZE);
+      return f;
+    }
+  return claim_frame (kpage);
+}
+
+/* Obtains a free frame from the user pool, as frame_alloc()
+   does, but returns a null pointer instead of evicting a page if
+   there is none.  Used to read ahead without pushing out pages
+   that are in use. */
+struct frame *
+frame_try_alloc (void) 
+{
+  void *kpage = palloc_get_page (PAL_USER);
+  return kpage != NULL ? claim_frame (kpage) : NULL;
+}
+
+/* Adds a reference to frame F and returns F.  A shared frame has
+   no single owner, so it cannot be evicted until all but one of
+   the references are dropped again. */
+struct frame *
+frame_ref (struct frame *f) 
+{
+  lock_acquire (&frame_lock);
+  ASSERT (f->ref_cnt > 0);
+  f->ref_cnt++;
+  update_owner (f);
+  lock_release (&frame_lock);
+  return f;
+}
+
+/* Returns a new reference to the frame in cache slot SLOT, or a
+   null pointer if SLOT is empty.  The slot is read under the
+   frame table's lock, because eviction may empty it at any
+   time. */
+struct frame *
+frame_get_cached (struct frame **slot) 
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  f = *slot;
+  if (f != NULL) 
+    {
+      f->ref_cnt++;
+      update_owner (f);
+    }
+  lock_release (&frame_lock);
+  return f;
+}
+
+/* Puts frame F, to which the caller holds a reference, into
+   cache slot SLOT, unless SLOT already holds a frame, and
+   returns a new reference to the frame that SLOT holds.  The
+   slot keeps a reference of its own until frame_uncache() or
+   eviction empties it.  The caller keeps its reference to F. */
+struct frame *
+frame_put_cached (struct frame **slot, struct frame *f) 
+{
+  lock_acquire (&frame_lock);
+  if (*slot == NULL) 
+    {
+      ASSERT (f->ref_cnt > 0 && f->cache_slot == NULL);
+      *slot = f;
+      f->cache_slot = slot;
+      f->ref_cnt++;
+    }
+  f = *slot;
+  f->ref_cnt++;
+  update_owner (f);
+  lock_release (&frame_lock);
+  return f;
+}
+
+/* Empties cache slot SLOT, dropping its reference to the frame
+   it holds, if any. */
+void
+frame_uncache (struct frame **slot) 
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  f = *slot;
+  if (f != NULL) 
+    {
+      *slot = NULL;
+      f->cache_slot = NULL;
+    }
+  lock_release (&frame_lock);
+
+  /* Dropping the reference makes the frame's remaining page, if
+     any, its owner. */
+  if (f != NULL)
+    frame_unref (f);
+}
+
+/* Returns a new reference to the shared zero frame.  It must
+   only be mapped read-only. */
+struct frame *
+frame_zero (void) 
+{
+  return frame_ref (zero_frame);
+}
+
+/* Returns true if F is the shared zero frame. */
+bool
+frame_is_zero (const struct frame *f) 
+{
+  return f == zero_frame;
+}
+
+/* Returns true if frame F has more than one reference, so that
+   it must not be written through any one page's mapping. */
+bool
+frame_is_shared (struct frame *f) 
+{
+  bool shared;
+
+  lock_acquire (&frame_lock);
+  shared = f->ref_cnt > 1;
+  lock_release (&frame_lock);
+  return shared;
+}
+
+/* Records that page P now maps frame F, holding one of F's
+   references.  If that is F's only reference, apart from a cache
+   slot, P owns F, which makes F a candidate for eviction. */
+void
+frame_add_page (struct frame *f, struct page *p) 
+{
+  lock_acquire (&frame_lock);
+  list_push_back (&f->pages, &p->frame_elem);
+  update_owner (f);
+  f->last_use = timer_ticks ();
+  lock_release (&frame_lock);
+}
+
+/* Records that page P, which mapped frame F, no longer does.  The
+   caller must drop or take over P's reference to F. */
+void
+frame_remove_page (struct frame *f, struct page *p) 
+{
+  lock_acquire (&frame_lock);
+  list_remove (&p->frame_elem);
+  update_owner (f);
+  lock_release (&frame_lock);
+}
+
+/* Drops a reference to frame F, freeing it if that was the last
+   one. */
+void
+frame_unref (struct frame *f) 
+{
+  bool last;
+
+  lock_acquire (&frame_lock);
+  ASSERT (f->ref_cnt > 0);
+  last = --f->ref_cnt == 0;
+  ASSERT (!last || (f->cache_slot == NULL && list_empty (&f->pages)));
+  update_owner (f);
+  if (f->ref_cnt - (f->cache_slot != NULL) == 0)
+    f->last_use = timer_ticks ();
+  lock_release (&frame_lock);
+
+  if (last)
+    palloc_free_page (f->kpage);
+}
+
+/* Returns the frame whose kernel virtual address is KPAGE, which
+   must be a page in the user pool. */
+struct frame *
+frame_lookup (void *kpage) 
+{
+  size_t idx = pg_no (kpage) - pg_no (user_base);
+
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (idx < frame_cnt);
+  return &frames[idx];
+}
+
+/* Returns the number of frames in the frame table. */
+size_t
+frame_count (void) 
+{
+  return frame_cnt;
+}
+
+/* Returns frame IDX in the frame table. */
+struct frame *
+frame_at (size_t idx) 
+{
+  ASSERT (idx < frame_cnt);
+  return &frames[idx];
+}
+
+/* If frame F belongs to exactly one page, and that page's lock
+   can be acquired without waiting, returns the page with its
+   lock held and stores its owner's page directory in *PD.
+   Otherwise, returns a null pointer.  While the lock is held, F
+   stays the page's frame. */
+struct page *
+frame_try_lock_page (struct frame *f, uint32_t **pd) 
+{
+  struct page *p;
+
+  lock_acquire (&frame_lock);
+  p = f->page;
+  if (p == NULL || p->thread->pagedir == NULL
+      || lock_held_by_current_thread (&p->lock)
+      || !lock_try_acquire (&p->lock))
+    p = NULL;
+  else
+    *pd = p->thread->pagedir;
+  lock_release (&frame_lock);
+  return p;
+}
+
+/* Returns the frame for KPAGE, newly obtained from the user
+   pool, with a reference count of 1. */
+static struct frame *
+claim_frame (void *kpage) 
+{
+  struct frame *f = frame_lookup (kpage);
+
+  lock_acquire (&frame_lock);
+  ASSERT (f->ref_cnt == 0 && f->cache_slot == NULL);
+  f->ref_cnt = 1;
+  f->page = NULL;
+  lock_release (&frame_lock);
+  return f;
+}
+
+/* Sets F's owner to the one page that maps it, if that page holds
+   F's only reference apart from a cache slot, and otherwise to
+   none.  Must be called with frame_lock held. */
+static void
+update_owner (struct frame *f) 
+{
+  struct list_elem *e = list_begin (&f->pages);
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  if (f->ref_cnt - (f->cache_slot != NULL) == 1
+      && e != list_end (&f->pages) && list_next (e) == list_end (&f->pages))
+    f->page = list_entry (e, struct page, frame_elem);
+  else
+    f->page = NULL;
+}
+
+/* Returns true if frame F, owned by page P in page directory PD,
+   should be evicted on the given PASS of the clock hand (0, 1, or
+   2) at time NOW.  Clears P's accessed bit as a side effect. */
+static bool
+is_victim (struct frame *f, struct page *p, uint32_t *pd, int pass,
+           int64_t now) 
+{
+  struct thread *t = p->thread;
+  bool spare;
+
+  if (pagedir_is_accessed (pd, p->upage)) 
+    {
+      pagedir_set_accessed (pd, p->upage, false);
+      f->last_use = now;
+      return false;
+    }
+  if (frame_policy == FRAME_CLOCK || pass == 2)
+    return true;
+
+  spare = (now - f->last_use > WS_WINDOW
+           || t->resident_cnt > t->resident_target);
+  return spare && (pass == 1 || !pagedir_is_dirty (pd, p->upage));
+}
+
+/* Takes frame F out of its cache slot.  The caller takes over
+   the slot's reference.  Must be called with frame_lock held. */
+static void
+take_from_cache (struct frame *f) 
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  *f->cache_slot = NULL;
+  f->cache_slot = NULL;
+}
+
+/* Picks a frame to evict and returns it with its owning page's
+   lock held, storing the owner's page directory in *PD, or
+   returns a null pointer if no frame can be evicted.  A frame
+   that only the cache holds is returned instead with no owner,
+   after taking it out of the cache.  Must be called with
+   frame_lock held. */
+static struct frame *
+choose_victim (uint32_t **pd_) 
+{
+  int64_t now = timer_ticks ();
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  for (i = 0; i < 3 * frame_cnt; i++) 
+    {
+      struct frame *f = &frames[hand];
+      struct page *p = f->page;
+      uint32_t *pd;
+
+      hand = (hand + 1) % frame_cnt;
+      if (p == NULL) 
+        {
+          if (f->ref_cnt == 1 && f->cache_slot != NULL
+              && (i >= frame_cnt || now - f->last_use > WS_WINDOW)) 
+            {
+              take_from_cache (f);
+              return f;
+            }
+          continue;
+        }
+
+      /* Skip pages whose owner is exiting, and file pages that
+         could not be written back because we already hold the
+         file system lock. */
+      pd = p->thread->pagedir;
+      if (pd == NULL
+          || (p->write_back && lock_held_by_current_thread (&filesys_lock))
+          || lock_held_by_current_thread (&p->lock))
+        continue;
+
+      if (is_victim (f, p, pd, i / frame_cnt, now)
+          && lock_try_acquire (&p->lock)) 
+        {
+          if (f->cache_slot != NULL) 
+            {
+              take_from_cache (f);
+              f->ref_cnt--;
+            }
+          *pd_ = pd;
+          return f;
+        }
+    }
+  return NULL;
+}
+
+/* Takes a frame away from the page that owns it and returns it
+   with a reference count of 1, or returns a null pointer if no
+   frame can be evicted. */
+static struct frame *
+evict_frame (void) 
+{
+  struct frame *f;
+  struct page *p;
+  uint32_t *pd = NULL;
+
+  lock_acquire (&frame_lock);
+  f = choose_victim (&pd);
+  if (f == NULL) 
+    {
+      lock_release (&frame_lock);
+      return NULL;
+    }
+  p = f->page;
+  lock_release (&frame_lock);
+
+  /* P's lock keeps anyone else from taking F while P is evicted.
+     On success, page_evict() removes P from F's pages. */
+  return p == NULL || page_evict (p, pd) ? f : NULL;
+}
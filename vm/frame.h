@@ -0,0 +1,63 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/palloc.h"
+
+struct page;
+
+/* A frame of physical memory in the user pool.
+
+   A frame may be mapped into more than one address space at a
+   time, and may also be held by kernel caches, so each frame
+   counts its references and is returned to the user pool only
+   when the last one is dropped.  Each frame also lists the pages
+   that map it.  Only a frame that belongs to exactly one page,
+   recorded in PAGE, may be evicted, but a reference held in a
+   cache slot does not count against that: eviction takes the
+   frame back from the cache.  When the other references to a
+   shared frame go away, the page left mapping it owns it
+   again. */
+struct frame
+  {
+    void *kpage;                /* Kernel virtual address. */
+    int ref_cnt;                /* Number of references, 0 if free. */
+    struct list pages;          /* Pages mapping the frame. */
+    struct page *page;          /* Sole owner, if evictable. */
+    struct frame **cache_slot;  /* Cache slot holding a reference. */
+    int64_t last_use;           /* Ticks when last seen accessed. */
+    unsigned checksum;          /* Content hash at last merge scan. */
+  };
+
+/* Page replacement policies. */
+enum frame_policy
+  {
+    FRAME_CLOCK,                /* Global second-chance clock. */
+    FRAME_WSCLOCK               /* WSClock with resident-set targets. */
+  };
+
+/* Page replacement policy in use, set with -evict. */
+extern enum frame_policy frame_policy;
+
+void frame_init (void);
+struct frame *frame_alloc (enum palloc_flags);
+struct frame *frame_try_alloc (void);
+struct frame *frame_ref (struct frame *);
+struct frame *frame_get_cached (struct frame **slot);
+struct frame *frame_put_cached (struct frame **slot, struct frame *);
+void frame_uncache (struct frame **slot);
+struct frame *frame_zero (void);
+bool frame_is_zero (const struct frame *);
+bool frame_is_shared (struct frame *);
+void frame_unref (struct frame *);
+void frame_add_page (struct frame *, struct page *);
+void frame_remove_page (struct frame *, struct page *);
+struct frame *frame_lookup (void *kpage);
+size_t frame_count (void);
+struct frame *frame_at (size_t idx);
+struct page *frame_try_lock_page (struct frame *, uint32_t **pd);
+
+#endif /* vm/frame.h */
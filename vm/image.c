@@ -0,0 +1,296 @@
+#include "vm/image.h"
+#include <debug.h>
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+
+/* Executable image cache.
+
+   Running the same program over and over again would otherwise
+   mean parsing its ELF headers and reading its text from disk
+   into fresh frames every time.  Instead, the headers of
+   recently run executables are kept here, keyed by inode
+   sector, together with the frames holding their read-only
+   pages, as processes fault them in.  Those frames are mapped
+   directly into each process, never copied.  Each process holds
+   a reference to its image for as long as it runs, so that its
+   pages can be faulted in from the image's segments.
+
+   The cached frames are not pinned: a frame that only the cache
+   holds is reclaimed by the frame table when memory runs short,
+   and one mapped by a single process leaves the cache when that
+   process's page is evicted.  Either way the page is read from
+   the file again on its next fault.
+
+   The cache holds each executable's inode open, so its sector
+   cannot be reused for another file while it is cached, and
+   records the inode's version, so that an executable that has
+   been written since it was cached is parsed again.  As a
+   consequence, the disk space of an executable that is removed
+   while cached is not freed until the image falls out of the
+   cache, after IMAGE_CACHE_MAX other executables have been
+   run. */
+
+/* Maximum number of images in the cache. */
+#define IMAGE_CACHE_MAX 16
+
+static struct list images;      /* Most recently used first. */
+static size_t image_cnt;        /* Number of images in IMAGES. */
+static struct lock image_lock;  /* Protects the cache. */
+
+static void image_uncache (struct image *);
+static void image_free (struct image *);
+
+/* Initializes the image cache. */
+void
+image_init (void) 
+{
+  list_init (&images);
+  lock_init (&image_lock);
+}
+
+/* Looks up the executable with the given INODE in the cache.
+   Returns the cached image, which the caller must release with
+   image_release(), or a null pointer if it is not cached. */
+struct image *
+image_lookup (struct inode *inode) 
+{
+  block_sector_t sector = inode_get_inumber (inode);
+  struct image *found = NULL;
+  struct list_elem *e;
+
+  lock_acquire (&image_lock);
+  for (e = list_begin (&images); e != list_end (&images);
+       e = list_next (e)) 
+    {
+      struct image *image = list_entry (e, struct image, elem);
+      if (image->sector == sector) 
+        {
+          if (image->version == inode_get_version (inode)) 
+            {
+              list_remove (&image->elem);
+              list_push_front (&images, &image->elem);
+              image->user_cnt++;
+              found = image;
+            }
+          else
+            image_uncache (image);
+          break;
+        }
+    }
+  lock_release (&image_lock);
+
+  return found;
+}
+
+/* Creates and returns a new image, with no segments, for the
+   executable with the given INODE.  The caller must add its
+   segments and entry point, may then add it to the cache with
+   image_insert(), and must release it with image_release().
+   Returns a null pointer if memory allocation fails. */
+struct image *
+image_create (struct inode *inode) 
+{
+  struct image *image = malloc (sizeof *image);
+  if (image != NULL) 
+    {
+      image->sector = inode_get_inumber (inode);
+      image->inode = inode_reopen (inode);
+      image->version = inode_get_version (inode);
+      image->cached = false;
+      image->user_cnt = 1;
+      image->entry = NULL;
+      image->segments = NULL;
+      image->segment_cnt = 0;
+    }
+  return image;
+}
+
+/* Adds a segment to IMAGE, which must not yet be in the cache.
+   The arguments are as for load_segment() in userprog/process.c.
+   Returns true if successful, false on memory allocation
+   failure. */
+bool
+image_add_segment (struct image *image, off_t ofs, uint8_t *upage,
+                   uint32_t read_bytes, uint32_t zero_bytes, bool writable) 
+{
+  struct image_segment *segments, *s;
+
+  ASSERT (!image->cached);
+  ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
+
+  segments = realloc (image->segments,
+                      (image->segment_cnt + 1) * sizeof *segments);
+  if (segments == NULL)
+    return false;
+  image->segments = segments;
+
+  s = &segments[image->segment_cnt];
+  s->ofs = ofs;
+  s->upage = upage;
+  s->read_bytes = read_bytes;
+  s->zero_bytes = zero_bytes;
+  s->writable = writable;
+  s->frames = NULL;
+  if (!writable) 
+    {
+      s->frames = calloc ((read_bytes + zero_bytes) / PGSIZE,
+                          sizeof *s->frames);
+      if (s->frames == NULL)
+        return false;
+    }
+  image->segment_cnt++;
+  return true;
+}
+
+/* Adds IMAGE to the cache, unless another image of the same
+   executable got there first.  Makes room by evicting the least
+   recently used images that are not in use. */
+void
+image_insert (struct image *image) 
+{
+  struct list_elem *e;
+
+  lock_acquire (&image_lock);
+  for (e = list_begin (&images); e != list_end (&images);
+       e = list_next (e))
+    if (list_entry (e, struct image, elem)->sector == image->sector)
+      break;
+  if (e == list_end (&images)) 
+    {
+      list_push_front (&images, &image->elem);
+      image->cached = true;
+      image_cnt++;
+
+      e = list_rbegin (&images);
+      while (image_cnt > IMAGE_CACHE_MAX && e != list_rend (&images)) 
+        {
+          struct image *victim = list_entry (e, struct image, elem);
+          e = list_prev (e);
+          if (victim->user_cnt == 0)
+            image_uncache (victim);
+        }
+    }
+  lock_release (&image_lock);
+}
+
+/* Maps every segment of IMAGE into the current process, backed
+   by FILE, which must be an open file for IMAGE's executable and
+   must stay open as long as the mappings exist.  Nothing is read
+   here; each page is read in by page_handle_fault() on first
+   access.  Read-only pages are then shared with every other
+   process running the executable, through the frames cached in
+   IMAGE; writable pages get a private copy.  Returns true if
+   successful, false if a memory allocation error occurs. */
+bool
+image_map (struct image *image, struct file *file) 
+{
+  struct image_segment *s;
+
+  for (s = image->segments; s < image->segments + image->segment_cnt; s++) 
+    {
+      size_t page_cnt = (s->read_bytes + s->zero_bytes) / PGSIZE;
+      size_t i;
+
+      for (i = 0; i < page_cnt; i++)
+        if (!page_map_image (s->upage + i * PGSIZE, file, s, i))
+          return false;
+    }
+  return true;
+}
+
+/* Returns a new reference to the frame that holds page IDX of
+   read-only segment S, or a null pointer if it has not been read
+   in yet or has been reclaimed. */
+struct frame *
+image_get_frame (struct image_segment *s, size_t idx) 
+{
+  ASSERT (!s->writable);
+
+  return frame_get_cached (&s->frames[idx]);
+}
+
+/* Offers FRAME, which holds the data of page IDX of read-only
+   segment S, to the cache, taking over the caller's reference to
+   it, and returns a new reference to the frame that the cache
+   holds for the page.  That is FRAME, unless another process
+   read the page in first, in which case FRAME is freed. */
+struct frame *
+image_put_frame (struct image_segment *s, size_t idx, struct frame *frame) 
+{
+  struct frame *cached;
+
+  ASSERT (!s->writable);
+
+  cached = frame_put_cached (&s->frames[idx], frame);
+  frame_unref (frame);
+  return cached;
+}
+
+/* Adds a reference to IMAGE, which must already have at least
+   one, and returns IMAGE. */
+struct image *
+image_ref (struct image *image) 
+{
+  lock_acquire (&image_lock);
+  ASSERT (image->user_cnt > 0);
+  image->user_cnt++;
+  lock_release (&image_lock);
+  return image;
+}
+
+/* Releases IMAGE, which was obtained from image_lookup() or
+   image_create().  Frees it if it is not in the cache and no one
+   else is using it.  IMAGE may be a null pointer. */
+void
+image_release (struct image *image) 
+{
+  if (image == NULL)
+    return;
+
+  lock_acquire (&image_lock);
+  ASSERT (image->user_cnt > 0);
+  if (--image->user_cnt == 0 && !image->cached)
+    image_free (image);
+  lock_release (&image_lock);
+}
+
+/* Removes IMAGE from the cache, freeing it unless it is in use.
+   Must be called with image_lock held. */
+static void
+image_uncache (struct image *image) 
+{
+  ASSERT (lock_held_by_current_thread (&image_lock));
+  ASSERT (image->cached);
+
+  list_remove (&image->elem);
+  image->cached = false;
+  image_cnt--;
+  if (image->user_cnt == 0)
+    image_free (image);
+}
+
+/* Frees IMAGE and drops its references to cached frames. */
+static void
+image_free (struct image *image) 
+{
+  size_t i, j;
+
+  for (i = 0; i < image->segment_cnt; i++) 
+    {
+      struct image_segment *s = &image->segments[i];
+      if (s->frames != NULL) 
+        {
+          size_t page_cnt = (s->read_bytes + s->zero_bytes) / PGSIZE;
+          for (j = 0; j < page_cnt; j++)
+            frame_uncache (&s->frames[j]);
+          free (s->frames);
+        }
+    }
+  free (image->segments);
+  inode_close (image->inode);
+  free (image);
+}
@@ -0,0 +1,57 @@
+#ifndef VM_IMAGE_H
+#define VM_IMAGE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+
+struct file;
+struct frame;
+struct inode;
+
+/* A loadable segment of an executable.  See load_segment() in
+   userprog/process.c for the meaning of READ_BYTES and
+   ZERO_BYTES. */
+struct image_segment
+  {
+    off_t ofs;                  /* Page-aligned offset in file. */
+    uint8_t *upage;             /* Page-aligned user virtual address. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero after READ_BYTES. */
+    bool writable;              /* Writable by the user process? */
+    struct frame **frames;      /* Cache slots for shared frames, if
+                                   read-only. */
+  };
+
+/* An executable's parsed ELF headers, along with the frames that
+   hold its read-only pages once they have been read. */
+struct image
+  {
+    struct list_elem elem;      /* Element in the image cache. */
+    block_sector_t sector;      /* Inode sector, the cache key. */
+    struct inode *inode;        /* Executable's inode. */
+    unsigned version;           /* INODE's version when parsed. */
+    bool cached;                /* In the image cache? */
+    int user_cnt;               /* Number of processes using the image. */
+    void (*entry) (void);       /* Entry point. */
+    struct image_segment *segments; /* Loadable segments. */
+    size_t segment_cnt;         /* Number of segments. */
+  };
+
+void image_init (void);
+struct image *image_lookup (struct inode *);
+struct image *image_create (struct inode *);
+bool image_add_segment (struct image *, off_t ofs, uint8_t *upage,
+                        uint32_t read_bytes, uint32_t zero_bytes,
+                        bool writable);
+void image_insert (struct image *);
+bool image_map (struct image *, struct file *);
+struct frame *image_get_frame (struct image_segment *, size_t idx);
+struct frame *image_put_frame (struct image_segment *, size_t idx,
+                               struct frame *);
+struct image *image_ref (struct image *);
+void image_release (struct image *);
+
+#endif /* vm/image.h */
@@ -0,0 +1,324 @@
+#include "vm/merge.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+
+/* Same-page merging.
+
+   A kernel thread at the lowest priority sweeps over the frame
+   table and looks for user frames with identical contents, so
+   that the pages mapping them can share a single frame,
+   read-only, and get back a private copy from page_unshare() if
+   they are written.
+
+   Each frame's contents are hashed with hash_bytes() on every
+   sweep, and only a frame whose hash has not changed since the
+   previous sweep is considered stable enough to merge.  A stable
+   frame is first looked up in the stable table, which holds a
+   reference to each frame that has been merged so far.  Failing
+   that, it is looked up in the unstable table, which lists the
+   stable frames seen so far in this sweep; a match there turns
+   the other frame into a new merged frame.  Otherwise, the frame
+   is added to the unstable table, which is emptied at the end of
+   each sweep.  Pages of zeros are merged into the shared zero
+   frame from frame_zero().
+
+   Frames are only compared and merged with interrupts off, after
+   the pages mapping them have been locked, so that neither
+   process can change a frame between the comparison and the
+   point where its page is unmapped.  Frames of memory-mapped
+   files are left alone, because their dirty bits must stay with
+   their pages, and so are frames of program text, which the
+   executable image cache already shares. */
+
+/* Frames scanned per second, 0 to disable merging. */
+size_t merge_rate = 0;
+
+/* Number of times per second that the merging thread wakes. */
+#define MERGE_HZ 10
+
+/* A frame in the stable or unstable table. */
+struct merge_node
+  {
+    struct hash_elem hash_elem;         /* Element in a table. */
+    struct list_elem list_elem;         /* Element in `stable_list'. */
+    unsigned hash;                      /* Hash of contents. */
+    struct frame *frame;                /* The frame. */
+  };
+
+/* Only used by the merging thread, so needs no lock. */
+static struct hash stable;              /* Merged frames, by hash. */
+static struct list stable_list;         /* Merged frames. */
+static struct hash unstable;            /* Candidates, by hash. */
+static unsigned zero_hash;              /* Hash of a page of zeros. */
+
+/* Statistics. */
+static long long scan_cnt;              /* Frames scanned. */
+static long long merge_cnt;             /* Pages merged. */
+static long long zero_cnt;              /* ...of which into the zero frame. */
+static size_t shared_cnt;               /* Frames in STABLE. */
+
+static thread_func merge_thread;
+static hash_hash_func node_hash;
+static hash_less_func node_less;
+static hash_action_func node_free;
+static void scan_frame (struct frame *);
+static void end_sweep (void);
+
+/* Starts the merging thread, if merging is enabled. */
+void
+merge_init (void) 
+{
+  struct frame *zero;
+
+  if (merge_rate == 0)
+    return;
+  if (!hash_init (&stable, node_hash, node_less, NULL)
+      || !hash_init (&unstable, node_hash, node_less, NULL))
+    PANIC ("merge_init: out of memory");
+  list_init (&stable_list);
+
+  zero = frame_zero ();
+  zero_hash = hash_bytes (zero->kpage, PGSIZE);
+  frame_unref (zero);
+
+  thread_create ("merge", PRI_MIN, merge_thread, NULL);
+}
+
+/* Prints merging statistics. */
+void
+merge_print_stats (void) 
+{
+  if (merge_rate == 0)
+    return;
+  printf ("Merge: %lld frames scanned, %lld pages merged "
+          "(%lld into the zero frame), %zu frames shared\n",
+          scan_cnt, merge_cnt, zero_cnt, shared_cnt);
+}
+
+/* Merging thread.  Scans MERGE_RATE frames a second, in batches
+   of MERGE_RATE / MERGE_HZ. */
+static void
+merge_thread (void *aux UNUSED) 
+{
+  size_t batch = merge_rate / MERGE_HZ > 0 ? merge_rate / MERGE_HZ : 1;
+  size_t idx = 0;
+
+  for (;;) 
+    {
+      size_t i;
+
+      for (i = 0; i < batch; i++) 
+        {
+          scan_frame (frame_at (idx));
+          if (++idx >= frame_count ()) 
+            {
+              idx = 0;
+              end_sweep ();
+            }
+        }
+      timer_sleep (TIMER_FREQ / MERGE_HZ);
+    }
+}
+
+/* Looks up a frame with hash HASH in TABLE.  Returns the node,
+   or a null pointer if there is none. */
+static struct merge_node *
+find_node (struct hash *table, unsigned hash) 
+{
+  struct merge_node key;
+  struct hash_elem *e;
+
+  key.hash = hash;
+  e = hash_find (table, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct merge_node, hash_elem) : NULL;
+}
+
+/* Makes page P, which is locked, belongs to page directory PD,
+   and owns frame F, share frame SHARED instead, if the two have
+   the same contents.  If CO_OWNER is nonnull, it must be the
+   locked owner of SHARED, in page directory CO_PD, and it is
+   unmapped as well, so that its next access sees SHARED as
+   shared.  Takes over the caller's reference to SHARED if
+   successful.  Returns true if successful, false if the frames
+   differ. */
+static bool
+merge_page (struct page *p, uint32_t *pd, struct frame *f,
+            struct frame *shared, struct page *co_owner, uint32_t *co_pd) 
+{
+  enum intr_level old_level;
+  bool same;
+
+  old_level = intr_disable ();
+  same = memcmp (f->kpage, shared->kpage, PGSIZE) == 0;
+  if (same) 
+    {
+      pagedir_clear_page (pd, p->upage);
+      if (co_owner != NULL)
+        pagedir_clear_page (co_pd, co_owner->upage);
+    }
+  intr_set_level (old_level);
+
+  if (!same)
+    return false;
+
+  /* The cleared PTEs keep their dirty bits, but the next fault
+     on each page maps it again with pagedir_set_page(), which
+     writes a fresh, clean PTE.  A page written before the merge
+     would then look like its file's data and be dropped on
+     eviction, so it must be swapped instead. */
+  p->file_copy = false;
+  if (co_owner != NULL)
+    co_owner->file_copy = false;
+  frame_remove_page (f, p);
+  frame_unref (f);
+  p->frame = shared;
+  frame_add_page (shared, p);
+  merge_cnt++;
+  return true;
+}
+
+/* Merges the contents of frame F with another frame, if F is
+   stable and such a frame can be found. */
+static void
+scan_frame (struct frame *f) 
+{
+  struct merge_node *n;
+  struct page *p;
+  uint32_t *pd;
+  unsigned hash;
+
+  p = frame_try_lock_page (f, &pd);
+  if (p == NULL)
+    return;
+  if (p->write_back || p->segment != NULL)
+    goto done;
+
+  scan_cnt++;
+  hash = hash_bytes (f->kpage, PGSIZE);
+  if (hash != f->checksum) 
+    {
+      /* Not stable yet. */
+      f->checksum = hash;
+      goto done;
+    }
+
+  if (hash == zero_hash) 
+    {
+      struct frame *zero = frame_zero ();
+      if (merge_page (p, pd, f, zero, NULL, NULL))
+        zero_cnt++;
+      else
+        frame_unref (zero);
+      goto done;
+    }
+
+  n = find_node (&stable, hash);
+  if (n != NULL) 
+    {
+      struct frame *shared = frame_ref (n->frame);
+      if (!merge_page (p, pd, f, shared, NULL, NULL))
+        frame_unref (shared);
+      goto done;
+    }
+
+  n = find_node (&unstable, hash);
+  if (n != NULL) 
+    {
+      /* The frame in N may since have changed hands or contents,
+         but it is checked again under its page's lock. */
+      struct frame *g = n->frame;
+      uint32_t *g_pd;
+      struct page *q = g != f ? frame_try_lock_page (g, &g_pd) : NULL;
+
+      if (q == NULL)
+        goto done;
+      if (!q->write_back && q->segment == NULL) 
+        {
+          frame_ref (g);
+          if (merge_page (p, pd, f, g, q, g_pd)) 
+            {
+              /* G moves to the stable table, which takes over N
+                 and holds a reference of its own. */
+              hash_delete (&unstable, &n->hash_elem);
+              n->frame = frame_ref (g);
+              hash_insert (&stable, &n->hash_elem);
+              list_push_back (&stable_list, &n->list_elem);
+              shared_cnt++;
+            }
+          else
+            frame_unref (g);
+        }
+      lock_release (&q->lock);
+      goto done;
+    }
+
+  n = malloc (sizeof *n);
+  if (n != NULL) 
+    {
+      n->hash = hash;
+      n->frame = f;
+      hash_insert (&unstable, &n->hash_elem);
+    }
+
+ done:
+  lock_release (&p->lock);
+}
+
+/* Ends a sweep over the frame table: forgets the unstable table,
+   and drops merged frames that no page uses any longer. */
+static void
+end_sweep (void) 
+{
+  struct list_elem *e, *next;
+
+  hash_clear (&unstable, node_free);
+  for (e = list_begin (&stable_list); e != list_end (&stable_list); e = next) 
+    {
+      struct merge_node *n = list_entry (e, struct merge_node, list_elem);
+
+      next = list_next (e);
+      if (n->frame->ref_cnt == 1) 
+        {
+          list_remove (&n->list_elem);
+          hash_delete (&stable, &n->hash_elem);
+          frame_unref (n->frame);
+          free (n);
+          shared_cnt--;
+        }
+    }
+}
+
+/* Returns the hash of the frame in node E. */
+static unsigned
+node_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_entry (e, struct merge_node, hash_elem)->hash;
+}
+
+/* Returns true if node A's hash is less than node B's. */
+static bool
+node_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED) 
+{
+  return (hash_entry (a, struct merge_node, hash_elem)->hash
+          < hash_entry (b, struct merge_node, hash_elem)->hash);
+}
+
+/* Frees node E of the unstable table. */
+static void
+node_free (struct hash_elem *e, void *aux UNUSED) 
+{
+  free (hash_entry (e, struct merge_node, hash_elem));
+}
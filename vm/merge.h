@@ -0,0 +1,13 @@
+#ifndef VM_MERGE_H
+#define VM_MERGE_H
+
+#include <stddef.h>
+
+/* Frames scanned per second by the merging thread, or 0 to not
+   merge at all.  Set with -merge. */
+extern size_t merge_rate;
+
+void merge_init (void);
+void merge_print_stats (void);
+
+#endif /* vm/merge.h */
@@ -0,0 +1,837 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "devices/timer.h"
+#include "threads/cycles.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/fault.h"
+#include "vm/frame.h"
+#include "vm/image.h"
+#include "vm/swap.h"
+
+/* Supplemental page table.
+
+   Each process keeps a hash table, keyed by user virtual
+   address, that describes every page in its address space.  The
+   hardware page table only says which frame a page is mapped
+   to; this table also tracks the frame's reference, so that
+   frames shared between processes are freed exactly once, and
+   where to find the page's data when it has no frame.
+
+   A page's lock is held while it is faulted in, evicted, or
+   removed, so that these never overlap.  The frame table only
+   ever tries to acquire it, so a page's lock may be held while
+   allocating a frame. */
+
+/* Maximum size of a process's stack, in pages.  8 MB by
+   default; set with the -sl kernel command-line option. */
+size_t page_stack_limit = 2048;
+
+/* How far below the stack pointer an access may fall and still
+   count as a stack access.  The 80x86 PUSHA instruction checks
+   access permissions before adjusting the stack pointer, so it
+   may fault up to 32 bytes below it. */
+#define STACK_SLOP 32
+
+/* Page fault frequency control of resident set targets.  A
+   process that faults pages in less than PFF_LOW ticks apart has
+   its target raised by PFF_STEP pages; one that goes more than
+   PFF_HIGH ticks between faults has it lowered, down to
+   PFF_MIN.  The target never exceeds the number of user frames,
+   so that after a burst of faults it takes a bounded number of
+   slow faults to bring it back down. */
+#define PFF_LOW 2
+#define PFF_HIGH 20
+#define PFF_STEP 8
+#define PFF_MIN 16
+
+/* Fault-around and read-ahead.  A fault on a file-backed page
+   also reads in the other pages of the same file, in the aligned
+   block of FAULT_AROUND pages around it, that have not been read
+   yet.  When faults arrive in sequential order, the window
+   instead starts at the faulting page and doubles with each
+   sequential fault, up to READ_AHEAD_MAX pages.  Neighbouring
+   pages only get frames that are free; they never cause
+   eviction. */
+#define FAULT_AROUND 8
+#define READ_AHEAD_MAX 32
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func page_free;
+
+/* Initializes PAGES as the current process's supplemental page
+   table, initially empty, and resets the process's resident set.
+   Returns true if successful, false on memory allocation
+   failure. */
+bool
+page_table_init (struct rhash *pages) 
+{
+  struct thread *t = thread_current ();
+
+  t->resident_cnt = 0;
+  t->resident_target = 4 * PFF_MIN;
+  t->last_fault = 0;
+  return rhash_init (pages, page_hash, page_less, NULL);
+}
+
+/* Destroys supplemental page table PAGES, which belongs to page
+   directory PD, and drops the references its pages hold on their
+   frames.  PD must not be the active page directory.  Afterward
+   no user page in PD is present, so pagedir_destroy() frees only
+   PD's page tables. */
+void
+page_table_destroy (struct rhash *pages, uint32_t *pd) 
+{
+  struct rhash_iterator i;
+
+  rhash_first (&i, pages);
+  while (rhash_next (&i)) 
+    {
+      struct page *p = hash_entry (rhash_cur (&i), struct page, hash_elem);
+
+      lock_acquire (&p->lock);
+      if (p->frame != NULL) 
+        {
+          pagedir_clear_page (pd, p->upage);
+          frame_remove_page (p->frame, p);
+          frame_unref (p->frame);
+        }
+      if (p->swap_slot != SWAP_ERROR)
+        swap_free (p->swap_slot);
+      lock_release (&p->lock);
+    }
+  rhash_destroy (pages, page_free);
+}
+
+/* Returns the page containing user virtual address UPAGE in the
+   current process, or a null pointer if there is none. */
+struct page *
+page_lookup (const void *upage) 
+{
+  struct page p;
+  struct hash_elem *e;
+
+  p.upage = pg_round_down (upage);
+  e = rhash_find (&thread_current ()->pages, &p.hash_elem);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Returns a new page at UPAGE in the current process, without
+   a frame or backing store, or a null pointer if memory
+   allocation fails.  The page is not yet in the supplemental
+   page table. */
+static struct page *
+page_create (void *upage, bool writable) 
+{
+  struct page *p = malloc (sizeof *p);
+  if (p != NULL) 
+    {
+      p->upage = upage;
+      p->frame = NULL;
+      p->writable = writable;
+      p->thread = thread_current ();
+      lock_init (&p->lock);
+      p->swap_slot = SWAP_ERROR;
+      p->evicted = false;
+      p->file = NULL;
+      p->write_back = false;
+      p->file_copy = false;
+      p->segment = NULL;
+    }
+  return p;
+}
+
+/* Makes FRAME the frame of page P, which belongs to the current
+   process, and maps it, read-only unless P is writable and
+   WRITABLE is true.  Returns false if memory allocation fails. */
+static bool
+page_set_frame (struct page *p, struct frame *frame, bool writable) 
+{
+  if (!pagedir_set_page (thread_current ()->pagedir, p->upage, frame->kpage,
+                         p->writable && writable))
+    return false;
+  p->frame = frame;
+  p->thread->resident_cnt++;
+  frame_add_page (frame, p);
+  return true;
+}
+
+/* Maps FRAME at user virtual address UPAGE in the current
+   process, read/write if WRITABLE is true and read-only
+   otherwise.  On success, the new page takes over the caller's
+   reference to FRAME.  Returns false if UPAGE is already in use
+   or if memory allocation fails. */
+bool
+page_install (void *upage, struct frame *frame, bool writable) 
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+
+  p = page_create (upage, writable);
+  if (p == NULL)
+    return false;
+  if (rhash_insert (&t->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      return false;
+    }
+  if (!page_set_frame (p, frame, true))
+    {
+      rhash_delete (&t->pages, &p->hash_elem);
+      free (p);
+      return false;
+    }
+  return true;
+}
+
+/* Maps BYTES bytes of FILE, starting at offset OFS, read/write
+   at user virtual address UPAGE in the current process.  No
+   frame is allocated and nothing is read until the page is first
+   accessed; the rest of the page past BYTES reads as zeros.
+   Returns false if UPAGE is already in use or if memory
+   allocation fails. */
+bool
+page_map_file (void *upage, struct file *file, off_t ofs, size_t bytes) 
+{
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (bytes <= PGSIZE);
+
+  p = page_create (upage, true);
+  if (p == NULL)
+    return false;
+  p->file = file;
+  p->file_ofs = ofs;
+  p->file_bytes = bytes;
+  p->write_back = true;
+
+  if (rhash_insert (&thread_current ()->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      return false;
+    }
+  return true;
+}
+
+/* Maps page IDX of executable segment S, read from FILE, at user
+   virtual address UPAGE in the current process.  As with
+   page_map_file(), nothing is read until the page is first
+   accessed, but the page is never written back to FILE.  A page
+   that lies wholly in the segment's zero-filled tail, as in BSS,
+   is not backed by FILE at all and starts out as zeros.
+   Returns false if UPAGE is already in use or if memory
+   allocation fails. */
+bool
+page_map_image (void *upage, struct file *file, struct image_segment *s,
+                size_t idx) 
+{
+  size_t ofs = idx * PGSIZE;
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+
+  p = page_create (upage, s->writable);
+  if (p == NULL)
+    return false;
+  if (s->read_bytes > ofs) 
+    {
+      p->file = file;
+      p->file_ofs = s->ofs + ofs;
+      p->file_bytes = (s->read_bytes - ofs < PGSIZE
+                       ? s->read_bytes - ofs : PGSIZE);
+      if (!s->writable) 
+        {
+          p->segment = s;
+          p->segment_idx = idx;
+        }
+    }
+
+  if (rhash_insert (&thread_current ()->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      return false;
+    }
+  return true;
+}
+
+/* Makes every page in the current process that is backed by file
+   OLD be backed by NEW instead.  fork() uses this to give the
+   child its own open files. */
+void
+page_rebind_file (struct file *old, struct file *new) 
+{
+  struct rhash_iterator i;
+
+  rhash_first (&i, &thread_current ()->pages);
+  while (rhash_next (&i)) 
+    {
+      struct page *p = hash_entry (rhash_cur (&i), struct page, hash_elem);
+      if (p->file == old)
+        p->file = new;
+    }
+}
+
+/* Removes the PAGE_CNT pages starting at UPAGE from the current
+   process.  Each memory-mapped file page whose dirty bit in the
+   page directory is set is first written back to the file; clean
+   pages are simply dropped.  The whole range is unmapped from the
+   page directory with a single TLB invalidation. */
+void
+page_unmap (void *upage, size_t page_cnt) 
+{
+  struct thread *t = thread_current ();
+  size_t i;
+
+  pagedir_clear_range (t->pagedir, upage, page_cnt);
+  for (i = 0; i < page_cnt; i++) 
+    {
+      struct page *p = page_lookup ((uint8_t *) upage + i * PGSIZE);
+
+      if (p == NULL)
+        continue;
+      lock_acquire (&p->lock);
+      if (p->frame != NULL) 
+        {
+          if (p->write_back && pagedir_is_dirty (t->pagedir, p->upage)) 
+            {
+              lock_acquire (&filesys_lock);
+              file_write_at (p->file, p->frame->kpage, p->file_bytes,
+                             p->file_ofs);
+              lock_release (&filesys_lock);
+            }
+          t->resident_cnt--;
+          frame_remove_page (p->frame, p);
+          frame_unref (p->frame);
+        }
+      if (p->swap_slot != SWAP_ERROR)
+        swap_free (p->swap_slot);
+      lock_release (&p->lock);
+      rhash_delete (&t->pages, &p->hash_elem);
+      free (p);
+    }
+}
+
+/* Copies the address space of PARENT into the current process,
+   which must have an empty supplemental page table, for fork().
+
+   No resident frame is copied here.  Instead, each of PARENT's
+   frames is mapped into the child as well, and writable pages
+   are mapped read-only in both processes, so that the first
+   write to one by either process faults and gets a private copy
+   from page_unshare().  Pages that PARENT has in swap are read
+   into private frames for the child.  Returns true if
+   successful, false if memory allocation fails. */
+bool
+page_table_copy (struct thread *parent) 
+{
+  struct thread *cur = thread_current ();
+  struct rhash_iterator i;
+  bool success = true;
+
+  rhash_first (&i, &parent->pages);
+  while (success && rhash_next (&i)) 
+    {
+      struct page *p = hash_entry (rhash_cur (&i), struct page, hash_elem);
+      struct page *c = page_create (p->upage, p->writable);
+
+      if (c == NULL)
+        return false;
+      c->file = p->file;
+      c->file_ofs = p->file_ofs;
+      c->file_bytes = p->file_bytes;
+      c->write_back = p->write_back;
+      c->segment = p->segment;
+      c->segment_idx = p->segment_idx;
+      if (rhash_insert (&cur->pages, &c->hash_elem) != NULL) 
+        {
+          free (c);
+          return false;
+        }
+
+      lock_acquire (&p->lock);
+      if (p->frame != NULL) 
+        {
+          if (p->writable)
+            pagedir_set_writable (parent->pagedir, p->upage, false);
+          c->file_copy = (p->file_copy
+                          && !pagedir_is_dirty (parent->pagedir, p->upage));
+          success = page_set_frame (c, frame_ref (p->frame), false);
+          if (!success)
+            frame_unref (p->frame);
+        }
+      else if (p->swap_slot != SWAP_ERROR) 
+        {
+          struct frame *frame = frame_alloc (0);
+          success = frame != NULL;
+          if (success) 
+            {
+              swap_read (p->swap_slot, frame->kpage);
+              success = page_set_frame (c, frame, true);
+              if (!success)
+                frame_unref (frame);
+            }
+        }
+      lock_release (&p->lock);
+    }
+  return success;
+}
+
+/* Gives the current process a private, writable copy of page P,
+   whose frame may be shared with other processes.  If no one
+   else references the frame any longer, it is simply made
+   writable.  Nothing else can add a reference to a frame that P
+   alone holds while P is locked.  Returns false if no frame is available for the
+   copy. */
+static bool
+page_unshare (struct page *p) 
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct frame *shared = p->frame;
+
+  if (frame_is_shared (shared)) 
+    {
+      bool zero = frame_is_zero (shared);
+      struct frame *copy = frame_alloc (zero ? PAL_ZERO : 0);
+      bool dirty = pagedir_is_dirty (pd, p->upage);
+      bool ok;
+
+      if (copy == NULL)
+        return false;
+      if (!zero)
+        memcpy (copy->kpage, shared->kpage, PGSIZE);
+
+      /* Keep the dirty bit, so that writes made before the page
+         was shared still reach a mapped file. */
+      pagedir_clear_page (pd, p->upage);
+      p->frame = copy;
+      ok = pagedir_set_page (pd, p->upage, copy->kpage, true);
+      ASSERT (ok);
+      pagedir_set_dirty (pd, p->upage, dirty);
+      frame_add_page (copy, p);
+      frame_remove_page (shared, p);
+      frame_unref (shared);
+    }
+  else
+    pagedir_set_writable (pd, p->upage, true);
+  return true;
+}
+
+/* Returns true if an access to ADDR, which is not yet mapped,
+   should grow the stack of a process whose user stack pointer is
+   ESP. */
+static bool
+is_stack_access (const void *addr, const void *esp) 
+{
+  return ((uint8_t *) addr >= (uint8_t *) esp - STACK_SLOP
+          && (uint8_t *) addr >= (uint8_t *) PHYS_BASE
+                                 - page_stack_limit * PGSIZE);
+}
+
+/* Gives page P, which is locked and has neither a frame nor any
+   backing store, a page of zeros.  A read maps the shared zero
+   frame, so that memory that is only ever read, such as much of
+   a large BSS array, takes no frame of its own; the first write
+   then gets a private frame from page_unshare().  A write gets a
+   private frame straight away.  Returns false if no frame is
+   available. */
+static bool
+page_zero_fill (struct page *p, bool write) 
+{
+  struct frame *frame;
+
+  write = write && p->writable;
+  frame = write ? frame_alloc (PAL_ZERO) : frame_zero ();
+  if (frame == NULL)
+    return false;
+  if (!page_set_frame (p, frame, write)) 
+    {
+      frame_unref (frame);
+      return false;
+    }
+  return true;
+}
+
+/* Extends the stack of the current process with a page of zeros
+   at UPAGE, which is accessed for writing if WRITE is true.
+   Returns false if no frame is available. */
+static bool
+grow_stack (void *upage, bool write) 
+{
+  struct page *p = page_create (upage, true);
+  bool success;
+
+  if (p == NULL)
+    return false;
+  if (rhash_insert (&thread_current ()->pages, &p->hash_elem) != NULL) 
+    {
+      free (p);
+      return false;
+    }
+  lock_acquire (&p->lock);
+  success = page_zero_fill (p, write);
+  lock_release (&p->lock);
+  return success;
+}
+
+/* Reads page P, which is locked and has no frame, into a new
+   frame from swap and maps it.  Returns false if no frame is
+   available. */
+static bool
+page_swap_in (struct page *p) 
+{
+  struct frame *frame = frame_alloc (0);
+
+  if (frame == NULL)
+    return false;
+
+  /* The swap slot is freed, so the page must be written out
+     again if it is evicted, even if it stays clean. */
+  swap_in (p->swap_slot, frame->kpage);
+  p->swap_slot = SWAP_ERROR;
+  p->file_copy = false;
+
+  if (!page_set_frame (p, frame, true)) 
+    {
+      frame_unref (frame);
+      return false;
+    }
+  return true;
+}
+
+/* Returns true if page Q can be read in along with page P, and
+   locks Q if so.  Q must belong to the current process and may
+   be a null pointer. */
+static bool
+lock_neighbour (struct page *p, struct page *q) 
+{
+  if (q == NULL || q == p || q->file != p->file
+      || lock_held_by_current_thread (&q->lock)
+      || !lock_try_acquire (&q->lock))
+    return false;
+  if (q->frame == NULL && q->swap_slot == SWAP_ERROR)
+    return true;
+  lock_release (&q->lock);
+  return false;
+}
+
+/* Gathers file-backed page P, which is locked, and the
+   neighbouring pages to read in with it into PAGES, locking
+   each of them, and returns the number of pages gathered.
+   Updates the current process's read-ahead state. */
+static size_t
+gather_neighbours (struct page *p, struct page *pages[READ_AHEAD_MAX]) 
+{
+  struct thread *t = thread_current ();
+  uint8_t *first, *upage;
+  size_t window, n;
+
+  if (p->upage == t->ra_next) 
+    {
+      /* Sequential access: read ahead, in a growing window. */
+      window = t->ra_pages * 2;
+      if (window > READ_AHEAD_MAX)
+        window = READ_AHEAD_MAX;
+      first = p->upage;
+    }
+  else 
+    {
+      /* Fault around P. */
+      window = FAULT_AROUND;
+      first = (uint8_t *) p->upage - pg_no (p->upage) % FAULT_AROUND * PGSIZE;
+    }
+  t->ra_pages = window;
+  t->ra_next = first + window * PGSIZE;
+
+  n = 0;
+  pages[n++] = p;
+  for (upage = first; upage < first + window * PGSIZE; upage += PGSIZE) 
+    {
+      struct page *q = is_user_vaddr (upage) ? page_lookup (upage) : NULL;
+      if (lock_neighbour (p, q))
+        pages[n++] = q;
+    }
+  return n;
+}
+
+/* Reads file-backed page P, which is locked and has no frame,
+   into a new frame and maps it, together with as many of its
+   neighbours as gather_neighbours() picks and free frames allow.
+   All of the file reads are made under a single acquisition of
+   the file system lock.  Sets *TYPE to FAULT_MINOR if P was
+   found in the executable image cache, FAULT_MAJOR otherwise.
+   Returns false if P could not be read in. */
+static bool
+page_in_file (struct page *p, enum fault_type *type) 
+{
+  struct page *pages[READ_AHEAD_MAX];
+  struct frame *frames[READ_AHEAD_MAX];
+  bool cached[READ_AHEAD_MAX];
+  size_t n, i;
+  bool success;
+
+  n = gather_neighbours (p, pages);
+
+  /* Find or allocate frames.  Only P may evict another page. */
+  for (i = 0; i < n; i++) 
+    {
+      struct page *q = pages[i];
+
+      frames[i] = (q->segment != NULL
+                   ? image_get_frame (q->segment, q->segment_idx) : NULL);
+      cached[i] = frames[i] != NULL;
+      if (frames[i] == NULL)
+        frames[i] = i == 0 ? frame_alloc (0) : frame_try_alloc ();
+      if (frames[i] == NULL) 
+        {
+          size_t j;
+          for (j = i; j < n; j++)
+            if (j > 0)
+              lock_release (&pages[j]->lock);
+          n = i;
+          break;
+        }
+    }
+  if (n == 0)
+    return false;
+
+  /* Read them all at once. */
+  lock_acquire (&filesys_lock);
+  for (i = 0; i < n; i++)
+    if (!cached[i]) 
+      {
+        struct page *q = pages[i];
+        off_t bytes_read = file_read_at (q->file, frames[i]->kpage,
+                                         q->file_bytes, q->file_ofs);
+        if (bytes_read < 0)
+          bytes_read = 0;
+        memset ((uint8_t *) frames[i]->kpage + bytes_read, 0,
+                PGSIZE - bytes_read);
+      }
+  lock_release (&filesys_lock);
+
+  /* Map them. */
+  success = false;
+  for (i = 0; i < n; i++) 
+    {
+      struct page *q = pages[i];
+      struct frame *frame = frames[i];
+      bool ok;
+
+      if (q->segment != NULL && !cached[i])
+        frame = image_put_frame (q->segment, q->segment_idx, frame);
+      q->file_copy = true;
+      ok = page_set_frame (q, frame, true);
+      if (!ok)
+        frame_unref (frame);
+      if (i == 0)
+        success = ok;
+      else
+        lock_release (&q->lock);
+    }
+
+  *type = cached[0] ? FAULT_MINOR : FAULT_MAJOR;
+  return success;
+}
+
+/* Evicts page P, which must own its frame and be locked by the
+   caller, from page directory PD, and releases P's lock.  A
+   memory-mapped file page is written back to its file if it is
+   dirty.  An executable page that still holds just what was read
+   from its file is dropped, to be read again on its next fault.
+   Any other page is written to swap.  On success, the
+   caller takes over P's reference to its frame.  Returns false
+   if swap is full, in which case P keeps its frame. */
+bool
+page_evict (struct page *p, uint32_t *pd) 
+{
+  struct frame *frame = p->frame;
+  bool dirty;
+
+  ASSERT (lock_held_by_current_thread (&p->lock));
+  ASSERT (frame != NULL);
+
+  /* Unmap first, so that the owner faults and waits on the lock
+     instead of modifying the page while it is written out. */
+  pagedir_clear_page (pd, p->upage);
+  dirty = pagedir_is_dirty (pd, p->upage);
+
+  if (p->write_back) 
+    {
+      if (dirty) 
+        {
+          lock_acquire (&filesys_lock);
+          file_write_at (p->file, frame->kpage, p->file_bytes, p->file_ofs);
+          lock_release (&filesys_lock);
+        }
+    }
+  else if (p->file != NULL && p->file_copy && !dirty) 
+    {
+      /* Clean executable page: page_in_file() can read it
+         again. */
+    }
+  else 
+    {
+      p->swap_slot = swap_out (frame->kpage);
+      if (p->swap_slot == SWAP_ERROR) 
+        {
+          bool ok = pagedir_set_page (pd, p->upage, frame->kpage, p->writable);
+          ASSERT (ok);
+          pagedir_set_dirty (pd, p->upage, dirty);
+          lock_release (&p->lock);
+          return false;
+        }
+    }
+
+  frame_remove_page (frame, p);
+  p->frame = NULL;
+  p->evicted = true;
+  p->thread->resident_cnt--;
+  lock_release (&p->lock);
+  return true;
+}
+
+/* Adjusts the current process's resident set target according
+   to how long it has been since it last faulted a page in. */
+static void
+pff_update (void) 
+{
+  struct thread *t = thread_current ();
+  int64_t now = timer_ticks ();
+  int64_t gap = now - t->last_fault;
+
+  t->last_fault = now;
+  if (gap < PFF_LOW && t->resident_target + PFF_STEP <= frame_count ())
+    t->resident_target += PFF_STEP;
+  else if (gap > PFF_HIGH && t->resident_target >= PFF_MIN + PFF_STEP)
+    t->resident_target -= PFF_STEP;
+}
+
+/* Resolves a page fault as described for page_handle_fault()
+   and stores its type in *TYPE, and in *REFAULT whether it
+   brought back an evicted page.  Returns true if successful,
+   false if the access was invalid. */
+static bool
+resolve_fault (void *fault_addr, bool not_present, bool write, void *esp,
+               enum fault_type *type, bool *refault) 
+{
+  struct page *p;
+  bool success;
+
+  if (!is_user_vaddr (fault_addr))
+    return false;
+  p = page_lookup (fault_addr);
+  *refault = false;
+  if (p == NULL)
+    {
+      *type = FAULT_STACK;
+      return (not_present && is_stack_access (fault_addr, esp)
+              && grow_stack (pg_round_down (fault_addr), write));
+    }
+
+  lock_acquire (&p->lock);
+  if (not_present) 
+    {
+      if (p->frame != NULL) 
+        {
+          /* A resident page that is just not mapped. */
+          *type = FAULT_MINOR;
+          success = pagedir_set_page (thread_current ()->pagedir, p->upage,
+                                      p->frame->kpage,
+                                      (p->writable
+                                       && !frame_is_shared (p->frame)));
+        }
+      else if (p->swap_slot != SWAP_ERROR) 
+        {
+          /* A page that was evicted to swap. */
+          *type = FAULT_MAJOR;
+          *refault = p->evicted;
+          success = page_swap_in (p);
+        }
+      else if (p->file == NULL) 
+        {
+          /* A page of zeros that has not been touched yet.  (A
+             zero page that was touched and then evicted went to
+             swap.) */
+          *type = FAULT_MINOR;
+          success = page_zero_fill (p, write);
+        }
+      else 
+        {
+          /* A file page that has not been read in yet, or was
+             dropped. */
+          *type = FAULT_MAJOR;
+          *refault = p->evicted;
+          success = page_in_file (p, type);
+        }
+    }
+  else 
+    {
+      /* A write to a writable page that is mapped read-only is a
+         write to a copy-on-write page. */
+      *type = FAULT_COW;
+      success = write && p->writable && page_unshare (p);
+    }
+  if (success)
+    p->evicted = false;
+  lock_release (&p->lock);
+  return success;
+}
+
+/* Attempts to resolve a page fault at FAULT_ADDR in the current
+   process.  NOT_PRESENT and WRITE describe the fault as in
+   page_fault() in userprog/exception.c, and ESP is the user
+   stack pointer at the time of the fault.  Returns true if the
+   faulting access may be retried, false if it was invalid.
+   Resolved faults are counted in the process's fault
+   statistics. */
+bool
+page_handle_fault (void *fault_addr, bool not_present, bool write,
+                   void *esp) 
+{
+  uint64_t start = rdtsc ();
+  enum fault_type type;
+  bool refault;
+
+  if (!resolve_fault (fault_addr, not_present, write, esp, &type, &refault))
+    return false;
+  if (type != FAULT_MINOR && type != FAULT_COW)
+    pff_update ();
+  fault_stats_record (&thread_current ()->faults, type, refault, fault_addr,
+                      start);
+  return true;
+}
+
+/* Returns a hash value for the page that E refers to. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return hash_int (pg_no (p->upage));
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED) 
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+  return a->upage < b->upage;
+}
+
+/* Frees the page that E refers to. */
+static void
+page_free (struct hash_elem *e, void *aux UNUSED) 
+{
+  free (hash_entry (e, struct page, hash_elem));
+}
@@ -0,0 +1,65 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <list.h>
+#include <rhash.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct file;
+struct frame;
+struct image_segment;
+struct thread;
+
+/* A page of user virtual memory in the supplemental page table. */
+struct page
+  {
+    void *upage;                /* User virtual address. */
+    struct frame *frame;        /* Frame holding the page's data. */
+    struct list_elem frame_elem; /* Element in FRAME's `pages'. */
+    bool writable;              /* Writable by the user process? */
+    struct thread *thread;      /* Owning process. */
+    struct lock lock;           /* Serializes faults and eviction. */
+    size_t swap_slot;           /* Swap slot, or SWAP_ERROR if none. */
+    bool evicted;               /* Evicted since last faulted in? */
+
+    /* File backing, if FILE is nonnull.  The page is read in on
+       first access.  A memory-mapped file page is written back
+       if dirty; an executable page is not: it is dropped on
+       eviction while it holds just the file's data, and swapped
+       like any other page once it has been changed.  A page
+       with no frame, swap slot, or file reads as zeros. */
+    struct file *file;          /* Mapped file or executable. */
+    off_t file_ofs;             /* Offset in FILE. */
+    size_t file_bytes;          /* Bytes to read; the rest are zero. */
+    bool write_back;            /* Write dirty data back to FILE? */
+    bool file_copy;             /* Frame read from FILE, changed only if
+                                   its PTE is dirty? */
+    struct image_segment *segment; /* Read-only executable segment. */
+    size_t segment_idx;         /* Page number within SEGMENT. */
+
+    struct hash_elem hash_elem; /* Element in thread's `pages'. */
+  };
+
+/* Maximum size of a process's stack, in pages. */
+extern size_t page_stack_limit;
+
+bool page_table_init (struct rhash *);
+void page_table_destroy (struct rhash *, uint32_t *pd);
+
+struct page *page_lookup (const void *upage);
+bool page_install (void *upage, struct frame *, bool writable);
+bool page_map_file (void *upage, struct file *, off_t ofs, size_t bytes);
+bool page_map_image (void *upage, struct file *, struct image_segment *,
+                     size_t idx);
+void page_rebind_file (struct file *old, struct file *new);
+void page_unmap (void *upage, size_t page_cnt);
+bool page_table_copy (struct thread *parent);
+bool page_evict (struct page *, uint32_t *pd);
+bool page_handle_fault (void *fault_addr, bool not_present, bool write,
+                        void *esp);
+
+#endif /* vm/page.h */
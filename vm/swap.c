@@ -0,0 +1,132 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
+
+/* Swap space.
+
+   The swap device is divided into page-size slots, each
+   PAGE_SECTORS consecutive sectors long, and a bitmap records
+   which slots are in use.  Without a swap device there are no
+   slots, so pages can only be swapped to the compressed store.
+
+   Pages are offered to the compressed store in vm/zswap.c
+   first, and only go to the swap device if it turns them down.
+   Entries in the compressed store are returned as slots with
+   SLOT_COMPRESSED set. */
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Marks a slot as an entry in the compressed store. */
+#define SLOT_COMPRESSED ((SIZE_MAX >> 1) + 1)
+
+static struct block *swap_device;   /* Swap device, if any. */
+static struct bitmap *swap_map;     /* Bitmap of slots in use. */
+static struct lock swap_lock;       /* Protects SWAP_MAP. */
+
+/* Statistics. */
+static long long read_cnt;          /* Pages read from swap. */
+static long long hit_cnt;           /* ...of which from the compressed store. */
+
+/* Sets up swap space. */
+void
+swap_init (void) 
+{
+  size_t slot_cnt = 0;
+
+  lock_init (&swap_lock);
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device != NULL)
+    slot_cnt = block_size (swap_device) / PAGE_SECTORS;
+  else
+    printf ("swap: no swap device\n");
+
+  swap_map = bitmap_create_flags (slot_cnt, BITMAP_SUMMARY);
+  if (swap_map == NULL)
+    PANIC ("swap_init: out of memory for %zu slots", slot_cnt);
+  zswap_init ();
+}
+
+/* Writes the page at KPAGE to a free swap slot and returns the
+   slot, or returns SWAP_ERROR if swap is full. */
+size_t
+swap_out (const void *kpage) 
+{
+  size_t slot, i;
+
+  slot = zswap_store (kpage);
+  if (slot != ZSWAP_ERROR)
+    return slot | SLOT_COMPRESSED;
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip_next (swap_map, 1, false);
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return SWAP_ERROR;
+
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_write (swap_device, slot * PAGE_SECTORS + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  return slot;
+}
+
+/* Reads the page in swap slot SLOT into KPAGE.  The slot stays
+   in use. */
+void
+swap_read (size_t slot, void *kpage) 
+{
+  size_t i;
+
+  read_cnt++;
+  if (slot & SLOT_COMPRESSED) 
+    {
+      hit_cnt++;
+      zswap_load (slot & ~SLOT_COMPRESSED, kpage);
+      return;
+    }
+
+  ASSERT (bitmap_test (swap_map, slot));
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_read (swap_device, slot * PAGE_SECTORS + i,
+                (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads the page in swap slot SLOT into KPAGE and frees the
+   slot. */
+void
+swap_in (size_t slot, void *kpage) 
+{
+  swap_read (slot, kpage);
+  swap_free (slot);
+}
+
+/* Frees swap slot SLOT. */
+void
+swap_free (size_t slot) 
+{
+  if (slot & SLOT_COMPRESSED) 
+    {
+      zswap_free (slot & ~SLOT_COMPRESSED);
+      return;
+    }
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_map, slot));
+  bitmap_reset (swap_map, slot);
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void) 
+{
+  printf ("Swap: %lld page reads, %lld from compressed store (%lld%%)\n",
+          read_cnt, hit_cnt, read_cnt > 0 ? hit_cnt * 100 / read_cnt : 0);
+  zswap_print_stats ();
+}
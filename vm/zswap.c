@@ -0,0 +1,297 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed page store.
+
+   Before a page goes to the swap device, it is compressed and,
+   if it shrinks to no more than ZSWAP_MAX bytes, kept in a
+   region of the kernel pool instead, so that faulting it back in
+   costs a decompression rather than disk I/O.  Pages that
+   compress poorly, and pages that do not fit once the region
+   fills up, are left to the swap device.
+
+   The region is divided into chunks of ZSWAP_CHUNK bytes, and a
+   stored page occupies a run of consecutive chunks, tracked in a
+   bitmap.  The first chunk of a run begins with the compressed
+   size, followed by the compressed data.  A page's entry is the
+   index of its first chunk.
+
+   The codec is a simple member of the LZ77 family, in the
+   manner of LZ4: a hash table of recent positions finds earlier
+   occurrences of each 4-byte sequence, and the output is a
+   stream of literal runs and back-references.  Each item starts
+   with a control byte C.  If C < 0x80, C + 1 literal bytes
+   follow.  Otherwise, the item copies (C & 0x7f) + LZ_MIN_MATCH
+   bytes from OFS bytes back in the output, where OFS is given by
+   the next two bytes, least significant first. */
+
+/* Size of the store, in pages. */
+size_t zswap_pages = 64;
+
+/* Size of a chunk of the store, in bytes. */
+#define ZSWAP_CHUNK 64
+
+/* Largest compressed page, including its header, that is worth
+   keeping. */
+#define ZSWAP_MAX (PGSIZE / 2)
+
+/* Codec parameters. */
+#define LZ_MIN_MATCH 4                  /* Shortest back-reference. */
+#define LZ_MAX_MATCH (0x7f + LZ_MIN_MATCH) /* Longest back-reference. */
+#define LZ_MAX_LITERAL 0x80             /* Longest literal run. */
+#define LZ_HASH_BITS 10                 /* Hash table has 2**this entries. */
+
+/* Header at the start of a stored page. */
+struct zswap_header
+  {
+    uint16_t size;                      /* Compressed bytes that follow. */
+  };
+
+static uint8_t *zswap_base;             /* Start of the region. */
+static struct bitmap *zswap_map;        /* Chunks in use. */
+static struct lock zswap_lock;          /* Protects everything here. */
+
+/* Scratch space for compression, protected by ZSWAP_LOCK.  Kept
+   out of the stack, which is only a page long. */
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+static uint8_t lz_buf[ZSWAP_MAX];
+
+/* Statistics. */
+static long long store_cnt;             /* Pages stored. */
+static long long reject_cnt;            /* Pages that compressed poorly. */
+static long long full_cnt;              /* Pages that found no room. */
+static long long load_cnt;              /* Pages loaded. */
+static long long stored_bytes;          /* Compressed size of stored pages. */
+
+static size_t lz_compress (const uint8_t *src, uint8_t *dst, size_t limit);
+static void lz_decompress (const uint8_t *src, size_t size, uint8_t *dst);
+
+/* Carves the compressed page store out of the kernel pool.  If
+   the pool cannot spare ZSWAP_PAGES pages, runs without it. */
+void
+zswap_init (void) 
+{
+  size_t chunk_cnt = zswap_pages * (PGSIZE / ZSWAP_CHUNK);
+
+  lock_init (&zswap_lock);
+  if (zswap_pages == 0)
+    return;
+  zswap_base = palloc_get_multiple (0, zswap_pages);
+  zswap_map = bitmap_create (chunk_cnt);
+  if (zswap_base == NULL || zswap_map == NULL) 
+    {
+      printf ("zswap: out of memory for %zu pages, "
+              "pages will not be compressed\n", zswap_pages);
+      if (zswap_base != NULL)
+        palloc_free_multiple (zswap_base, zswap_pages);
+      if (zswap_map != NULL)
+        bitmap_destroy (zswap_map);
+      zswap_base = NULL;
+      zswap_map = NULL;
+      zswap_pages = 0;
+    }
+}
+
+/* Compresses the page at KPAGE into the store and returns its
+   entry, or returns ZSWAP_ERROR if the page compresses poorly or
+   the store is full. */
+size_t
+zswap_store (const void *kpage) 
+{
+  struct zswap_header *h;
+  size_t size, entry;
+
+  if (zswap_map == NULL)
+    return ZSWAP_ERROR;
+
+  lock_acquire (&zswap_lock);
+  size = lz_compress (kpage, lz_buf, ZSWAP_MAX - sizeof *h);
+  if (size == 0) 
+    {
+      reject_cnt++;
+      lock_release (&zswap_lock);
+      return ZSWAP_ERROR;
+    }
+
+  entry = bitmap_scan_and_flip_next (zswap_map,
+                                     DIV_ROUND_UP (sizeof *h + size,
+                                                   ZSWAP_CHUNK),
+                                     false);
+  if (entry == BITMAP_ERROR) 
+    {
+      full_cnt++;
+      lock_release (&zswap_lock);
+      return ZSWAP_ERROR;
+    }
+
+  h = (struct zswap_header *) (zswap_base + entry * ZSWAP_CHUNK);
+  h->size = size;
+  memcpy (h + 1, lz_buf, size);
+  store_cnt++;
+  stored_bytes += size;
+  lock_release (&zswap_lock);
+  return entry;
+}
+
+/* Decompresses the page stored in ENTRY into KPAGE.  The entry
+   stays in use. */
+void
+zswap_load (size_t entry, void *kpage) 
+{
+  const struct zswap_header *h;
+
+  lock_acquire (&zswap_lock);
+  ASSERT (bitmap_test (zswap_map, entry));
+  h = (const struct zswap_header *) (zswap_base + entry * ZSWAP_CHUNK);
+  lz_decompress ((const uint8_t *) (h + 1), h->size, kpage);
+  load_cnt++;
+  lock_release (&zswap_lock);
+}
+
+/* Frees ENTRY. */
+void
+zswap_free (size_t entry) 
+{
+  const struct zswap_header *h;
+
+  lock_acquire (&zswap_lock);
+  ASSERT (bitmap_test (zswap_map, entry));
+  h = (const struct zswap_header *) (zswap_base + entry * ZSWAP_CHUNK);
+  bitmap_set_multiple (zswap_map, entry,
+                       DIV_ROUND_UP (sizeof *h + h->size, ZSWAP_CHUNK),
+                       false);
+  lock_release (&zswap_lock);
+}
+
+/* Prints compressed page store statistics. */
+void
+zswap_print_stats (void) 
+{
+  long long tried = store_cnt + reject_cnt + full_cnt;
+
+  if (zswap_map == NULL)
+    return;
+  printf ("zswap: %lld of %lld pages stored (%lld incompressible, "
+          "%lld store full), %lld loads\n",
+          store_cnt, tried, reject_cnt, full_cnt, load_cnt);
+  if (store_cnt > 0)
+    printf ("zswap: pages compressed to %lld%% of their size on average\n",
+            stored_bytes * 100 / (store_cnt * PGSIZE));
+}
+
+/* Returns the 4 bytes at P. */
+static inline uint32_t
+read32 (const uint8_t *p) 
+{
+  uint32_t x;
+  memcpy (&x, p, sizeof x);
+  return x;
+}
+
+/* Appends SRC[0...N - 1] to DST[*OP...] as literal runs, without
+   exceeding LIMIT bytes of output.  Returns false if it does not
+   fit. */
+static bool
+lz_literals (const uint8_t *src, size_t n, uint8_t *dst, size_t *op,
+             size_t limit) 
+{
+  while (n > 0) 
+    {
+      size_t run = n < LZ_MAX_LITERAL ? n : LZ_MAX_LITERAL;
+      if (*op + 1 + run > limit)
+        return false;
+      dst[(*op)++] = run - 1;
+      memcpy (dst + *op, src, run);
+      *op += run;
+      src += run;
+      n -= run;
+    }
+  return true;
+}
+
+/* Compresses the page at SRC into DST and returns the number of
+   bytes written, or 0 if that would be more than LIMIT. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t limit) 
+{
+  size_t ip = 0;                /* Input position. */
+  size_t lit = 0;               /* Start of pending literals. */
+  size_t op = 0;                /* Output position. */
+
+  memset (lz_table, 0, sizeof lz_table);
+  while (ip + LZ_MIN_MATCH <= PGSIZE) 
+    {
+      uint32_t seq = read32 (src + ip);
+      size_t hash = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+      size_t cand = lz_table[hash];
+      size_t len;
+
+      lz_table[hash] = ip;
+      if (cand >= ip || read32 (src + cand) != seq) 
+        {
+          ip++;
+          continue;
+        }
+
+      len = LZ_MIN_MATCH;
+      while (ip + len < PGSIZE && len < LZ_MAX_MATCH
+             && src[cand + len] == src[ip + len])
+        len++;
+
+      if (!lz_literals (src + lit, ip - lit, dst, &op, limit)
+          || op + 3 > limit)
+        return 0;
+      dst[op++] = 0x80 | (len - LZ_MIN_MATCH);
+      dst[op++] = (ip - cand) & 0xff;
+      dst[op++] = (ip - cand) >> 8;
+      ip += len;
+      lit = ip;
+    }
+
+  if (!lz_literals (src + lit, PGSIZE - lit, dst, &op, limit))
+    return 0;
+  return op;
+}
+
+/* Decompresses the SIZE bytes at SRC into the page at DST. */
+static void
+lz_decompress (const uint8_t *src, size_t size, uint8_t *dst) 
+{
+  const uint8_t *end = src + size;
+  size_t op = 0;
+
+  while (src < end) 
+    {
+      uint8_t c = *src++;
+      if (c < 0x80) 
+        {
+          size_t run = c + 1;
+          ASSERT (op + run <= PGSIZE);
+          memcpy (dst + op, src, run);
+          src += run;
+          op += run;
+        }
+      else 
+        {
+          size_t len = (c & 0x7f) + LZ_MIN_MATCH;
+          size_t ofs = src[0] | (src[1] << 8);
+
+          src += 2;
+          ASSERT (ofs > 0 && ofs <= op && op + len <= PGSIZE);
+
+          /* Copy byte by byte: the source may overlap the
+             destination. */
+          for (; len > 0; len--, op++)
+            dst[op] = dst[op - ofs];
+        }
+    }
+  ASSERT (op == PGSIZE);
+}
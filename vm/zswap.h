@@ -0,0 +1,19 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stddef.h>
+
+/* Returned by zswap_store() when a page is not stored. */
+#define ZSWAP_ERROR SIZE_MAX
+
+/* Size of the compressed page store, in pages of the kernel
+   pool.  Set with -zswap. */
+extern size_t zswap_pages;
+
+void zswap_init (void);
+size_t zswap_store (const void *kpage);
+void zswap_load (size_t entry, void *kpage);
+void zswap_free (size_t entry);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */